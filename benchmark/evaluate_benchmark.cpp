@@ -0,0 +1,239 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+#include <accuracy/search_accuracy.hpp>
+#include <utilities/consolidate/consolidate_matches.hpp>
+#include <utilities/consolidate/io.hpp>
+#include <utilities/radix_sort.hpp>
+
+#include "synthetic_data.hpp"
+
+namespace
+{
+
+valik::benchmark::synthetic_scale scale{};
+std::filesystem::path data_directory{}; // empty if the synthetic data is written to a temporary directory
+
+std::filesystem::path temporary_directory()
+{
+    return std::filesystem::temp_directory_path() / ("valik_evaluate_benchmark_" + std::to_string(getpid()));
+}
+
+/**
+ * @brief Function that generates the synthetic data on first use.
+ */
+valik::benchmark::synthetic_data const & benchmark_data()
+{
+    static valik::benchmark::synthetic_data const data =
+        valik::benchmark::generate_synthetic_data(scale, data_directory.empty() ? temporary_directory() : data_directory);
+    return data;
+}
+
+template <typename match_t>
+std::filesystem::path const & truth_path()
+{
+    return std::is_same_v<match_t, valik::stellar_match> ? benchmark_data().truth_gff : benchmark_data().truth_txt;
+}
+
+template <typename match_t>
+std::filesystem::path const & test_path()
+{
+    return std::is_same_v<match_t, valik::stellar_match> ? benchmark_data().test_gff : benchmark_data().test_txt;
+}
+
+// Parsing, sorting, consolidation, the overlap search and writing are measured separately on the truth or test set.
+// The first argument of each benchmark is the number of threads.
+
+template <typename match_t>
+void parse(benchmark::State & state)
+{
+    valik::custom::metadata const meta(benchmark_data().meta);
+    size_t const threads = state.range(0);
+    size_t match_count{0};
+    for (auto _ : state)
+    {
+        valik::match_dictionary dictionary{};
+        auto matches = valik::read_alignment_output<match_t>(truth_path<match_t>(), meta, dictionary,
+                                                             std::ios_base::in, threads);
+        match_count = matches.size();
+        benchmark::DoNotOptimize(matches.data());
+    }
+    state.SetItemsProcessed(state.iterations() * match_count);
+    state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(truth_path<match_t>()));
+}
+
+template <typename match_t>
+void sort(benchmark::State & state)
+{
+    valik::custom::metadata const meta(benchmark_data().meta);
+    valik::match_dictionary dictionary{};
+    auto const matches = valik::read_alignment_output<match_t>(truth_path<match_t>(), meta, dictionary);
+    size_t const threads = state.range(0);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        auto unsorted = matches;
+        state.ResumeTiming();
+        valik::sort_matches(unsorted, threads);
+        benchmark::DoNotOptimize(unsorted.data());
+    }
+    state.SetItemsProcessed(state.iterations() * matches.size());
+}
+
+template <typename match_t>
+void consolidate(benchmark::State & state)
+{
+    valik::custom::metadata const meta(benchmark_data().meta);
+    valik::match_dictionary dictionary{};
+    auto const matches = get_sorted_alignments<match_t>(test_path<match_t>(), meta, dictionary);
+    accuracy_arguments arguments{};
+    arguments.numMatches = std::max<size_t>(scale.matches_per_query / 2, 1);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        auto consolidated = matches;
+        state.ResumeTiming();
+        valik::custom::consolidate_matches(consolidated, dictionary, arguments);
+        benchmark::DoNotOptimize(consolidated.data());
+    }
+    state.SetItemsProcessed(state.iterations() * matches.size());
+}
+
+template <typename match_t>
+void overlap(benchmark::State & state)
+{
+    valik::custom::metadata const meta(benchmark_data().meta);
+    valik::match_dictionary dictionary{};
+    auto const truth = get_sorted_alignments<match_t>(truth_path<match_t>(), meta, dictionary);
+    auto const test = get_sorted_alignments<match_t>(test_path<match_t>(), meta, dictionary);
+    size_t const threads = state.range(0);
+    for (auto _ : state)
+    {
+        auto const result = evaluate_accuracy(truth, test, size_t{50}, threads);
+        benchmark::DoNotOptimize(result.true_positive_count);
+    }
+    state.SetItemsProcessed(state.iterations() * (truth.size() + test.size()));
+}
+
+template <typename match_t>
+void write(benchmark::State & state)
+{
+    valik::custom::metadata const meta(benchmark_data().meta);
+    valik::match_dictionary dictionary{};
+    auto const matches = get_sorted_alignments<match_t>(test_path<match_t>(), meta, dictionary);
+    std::filesystem::path const out_path = benchmark_data().test_gff.parent_path() / "written";
+    for (auto _ : state)
+        valik::write_alignment_output(out_path, matches, meta, dictionary);
+
+    state.SetItemsProcessed(state.iterations() * matches.size());
+    state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(out_path));
+    std::filesystem::remove(out_path);
+}
+
+BENCHMARK_TEMPLATE(parse, valik::stellar_match)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(parse, blast_match)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(sort, valik::stellar_match)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(consolidate, valik::stellar_match)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(overlap, valik::stellar_match)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(overlap, blast_match)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(write, valik::stellar_match)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(write, blast_match)->Unit(benchmark::kMillisecond);
+
+/**
+ * @brief Function that reads an option of the synthetic data, e.g. --queries=1000, and returns whether it was one.
+ */
+bool parse_scale_option(std::string_view const argument)
+{
+    size_t const equals = argument.find('=');
+    if (!argument.starts_with("--") || equals == std::string_view::npos)
+        return false;
+
+    std::string_view const name = argument.substr(2, equals - 2);
+    std::string const value{argument.substr(equals + 1)};
+    if (name == "references")
+        scale.reference_count = std::stoull(value);
+    else if (name == "reference-length")
+        scale.reference_length = std::stoull(value);
+    else if (name == "queries")
+        scale.query_count = std::stoull(value);
+    else if (name == "matches-per-query")
+        scale.matches_per_query = std::stoull(value);
+    else if (name == "overlap-fraction")
+        scale.overlap_fraction = std::stod(value);
+    else if (name == "skew")
+        scale.skew = std::stod(value);
+    else if (name == "seed")
+        scale.seed = std::stoull(value);
+    else if (name == "data-dir")
+        data_directory = value;
+    else
+        return false;
+    return true;
+}
+
+} // namespace
+
+/**
+ * Besides the options of Google Benchmark, the scale of the synthetic data can be set with
+ * --references, --reference-length, --queries, --matches-per-query, --overlap-fraction, --skew and --seed.
+ * With --data-dir=<dir> the data is kept in dir, e.g. to size a job with the evaluate binary, and
+ * --generate-only writes it without running the benchmarks.
+ */
+int main(int argc, char ** argv)
+{
+    benchmark::Initialize(&argc, argv);
+
+    bool generate_only{false};
+    int kept_argc{1};
+    try
+    {
+        for (int i{1}; i < argc; i++)
+        {
+            std::string_view const argument{argv[i]};
+            if (argument == "--generate-only")
+                generate_only = true;
+            else if (!parse_scale_option(argument))
+                argv[kept_argc++] = argv[i];
+        }
+    }
+    catch (std::exception const & e)
+    {
+        std::cerr << "[Error] Invalid value of a synthetic data option: " << e.what() << '\n';
+        return -1;
+    }
+
+    argc = kept_argc;
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return -1;
+
+    if (generate_only)
+    {
+        if (data_directory.empty())
+        {
+            std::cerr << "[Error] --generate-only requires --data-dir.\n";
+            return -1;
+        }
+        benchmark_data();
+        return 0;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    if (data_directory.empty())
+        std::filesystem::remove_all(temporary_directory());
+    return 0;
+}
@@ -0,0 +1,179 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <valik/split/metadata.hpp>
+
+namespace valik::benchmark
+{
+
+/**
+ * @brief Size and shape of a synthetic evaluation.
+ */
+struct synthetic_scale
+{
+    size_t reference_count{24};
+    uint64_t reference_length{50'000'000};
+    size_t query_count{1000};
+    size_t matches_per_query{100};  // truth matches of each query
+    double overlap_fraction{0.6};   // fraction of truth matches that are found by a test match
+    double skew{0.0};               // Zipf exponent of the distribution of matches over references, 0 is uniform
+    uint64_t seed{42};
+};
+
+/**
+ * @brief Paths of the files of a synthetic evaluation.
+ */
+struct synthetic_data
+{
+    std::filesystem::path meta;
+    std::filesystem::path truth_gff;
+    std::filesystem::path truth_txt;
+    std::filesystem::path test_gff;
+    std::filesystem::path test_txt;
+};
+
+namespace detail
+{
+
+struct synthetic_match
+{
+    size_t ref_ind;
+    uint64_t dbegin;
+    uint64_t dend;
+    size_t query;
+    uint64_t qbegin;
+    uint64_t qend;
+    bool is_forward_match;
+};
+
+inline void write_matches(std::filesystem::path const & gff_path,
+                          std::filesystem::path const & txt_path,
+                          std::vector<synthetic_match> const & matches,
+                          std::mt19937_64 & generator)
+{
+    std::ofstream gff(gff_path);
+    std::ofstream txt(txt_path);
+    if (!gff.is_open() || !txt.is_open())
+        throw std::runtime_error{"Could not write synthetic matches to " + gff_path.parent_path().string()};
+
+    std::uniform_real_distribution<double> percid(95.0, 100.0);
+    std::string gff_line{};
+    std::string txt_line{};
+    for (auto const & match : matches)
+    {
+        std::string const ref_id = "chr" + std::to_string(match.ref_ind + 1);
+        std::string const query_id = "query" + std::to_string(match.query);
+        std::string const identity = std::to_string(percid(generator)).substr(0, 7);
+        std::string const dbegin = std::to_string(match.dbegin);
+        std::string const dend = std::to_string(match.dend);
+        std::string const qbegin = std::to_string(match.qbegin);
+        std::string const qend = std::to_string(match.qend);
+
+        gff_line = ref_id + "\tStellar\teps-matches\t" + dbegin + '\t' + dend + '\t' + identity + '\t' +
+                   (match.is_forward_match ? '+' : '-') + "\t.\t" + query_id + ";seq2Range=" + qbegin + ',' + qend +
+                   ";eValue=1.5e-40;cigar=" + std::to_string(match.dend - match.dbegin) + "M;mutations=5C,14A\n";
+        txt_line = ref_id + '\t' + dbegin + '\t' + dend + '\t' + identity + '\t' +
+                   (match.is_forward_match ? "plus" : "minus") + "\t1e-40\t" + query_id + '\t' + qbegin + '\t' +
+                   qend + '\n';
+        gff << gff_line;
+        txt << txt_line;
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief Function that writes reference metadata and truth and test matches in GFF and BLAST tabular format.
+ *
+ * Every query has scale.matches_per_query truth matches on references drawn with a Zipf distribution. A fraction of
+ * the truth matches gets a shifted test match that overlaps it by about half its length, the remaining test matches
+ * are placed at random. Both sets are written in random order, so that they have to be sorted.
+ */
+inline synthetic_data generate_synthetic_data(synthetic_scale const & scale, std::filesystem::path const & directory)
+{
+    std::filesystem::create_directories(directory);
+    synthetic_data const data{directory / "meta.bin",
+                              directory / "truth.gff",
+                              directory / "truth.txt",
+                              directory / "test.gff",
+                              directory / "test.txt"};
+
+    valik::custom::metadata meta{};
+    meta.pattern_size = 50;
+    meta.ibf_fpr = 0.05;
+    meta.files.emplace_back(0, "synthetic.fasta");
+    for (size_t ref_ind{0}; ref_ind < scale.reference_count; ref_ind++)
+    {
+        meta.sequences.emplace_back(0, "chr" + std::to_string(ref_ind + 1), ref_ind, scale.reference_length);
+        meta.segments.emplace_back(ref_ind, 0, scale.reference_length);
+        meta.segments.back().id = ref_ind;
+        meta.total_len += scale.reference_length;
+    }
+    meta.save(data.meta);
+
+    std::vector<double> reference_weights(scale.reference_count);
+    for (size_t ref_ind{0}; ref_ind < scale.reference_count; ref_ind++)
+        reference_weights[ref_ind] = 1.0 / std::pow(ref_ind + 1, scale.skew);
+
+    std::mt19937_64 generator{scale.seed};
+    std::discrete_distribution<size_t> reference(reference_weights.begin(), reference_weights.end());
+    std::uniform_int_distribution<uint64_t> match_length(100, 500);
+    std::uniform_int_distribution<uint64_t> position(1, std::max<uint64_t>(scale.reference_length, 1001) - 1000);
+    std::uniform_int_distribution<uint64_t> query_position(1, 1'000'000);
+    std::bernoulli_distribution is_forward(0.7);
+    std::bernoulli_distribution is_found(scale.overlap_fraction);
+
+    auto random_match = [&](size_t const query)
+    {
+        uint64_t const dbegin = position(generator);
+        uint64_t const qbegin = query_position(generator);
+        uint64_t const length = match_length(generator);
+        return detail::synthetic_match{reference(generator), dbegin, dbegin + length, query, qbegin, qbegin + length,
+                                       is_forward(generator)};
+    };
+
+    std::vector<detail::synthetic_match> truth{};
+    std::vector<detail::synthetic_match> test{};
+    truth.reserve(scale.query_count * scale.matches_per_query);
+    test.reserve(truth.capacity());
+    for (size_t query{0}; query < scale.query_count; query++)
+    {
+        for (size_t m{0}; m < scale.matches_per_query; m++)
+        {
+            truth.push_back(random_match(query));
+            if (is_found(generator))
+            {
+                detail::synthetic_match found = truth.back();
+                uint64_t const shift = (found.dend - found.dbegin) / 2;
+                found.dbegin += shift;
+                found.dend += shift;
+                found.qbegin += shift;
+                found.qend += shift;
+                test.push_back(found);
+            }
+        }
+    }
+    while (test.size() < truth.size())
+        test.push_back(random_match(test.size() % std::max<size_t>(scale.query_count, 1)));
+
+    std::ranges::shuffle(truth, generator);
+    std::ranges::shuffle(test, generator);
+    detail::write_matches(data.truth_gff, data.truth_txt, truth, generator);
+    detail::write_matches(data.test_gff, data.test_txt, test, generator);
+    return data;
+}
+
+} // namespace valik::benchmark
@@ -4,41 +4,58 @@
 
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <ranges>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+
 #include <argument_parsing/accuracy_arguments.hpp>
+#include <utilities/alignment_writer.hpp>
+#include <utilities/match_dictionary.hpp>
+#include <utilities/shared.hpp>
 #include <valik/split/metadata.hpp>
 
+/**
+ * @brief A BLAST tabular record. The reference is kept as its index in the metadata and the query as its id in a
+ *        match_dictionary. Numbers are written back in the format they were read in.
+ */
 struct blast_match
 {
-    std::string dname{};
     size_t ref_ind{};
     uint64_t dbegin{};
     uint64_t dend{};
-    std::string percid;
+    float percid{};
     bool is_forward_match{true};
-    std::string evalue{};
-    std::string qname{};
+    uint32_t qid{};
     uint64_t qbegin{};
     uint64_t qend{};
+    double evalue{};
+    valik::number_format percid_format{};
+    valik::number_format evalue_format{};
 
-    blast_match(std::vector<std::string> const & match_vec, valik::custom::metadata const & meta)
+    template <std::ranges::random_access_range fields_t>
+        requires std::convertible_to<std::ranges::range_reference_t<fields_t const &>, std::string_view>
+    blast_match(fields_t const & match_vec, valik::custom::metadata const & meta, valik::match_dictionary & dictionary)
     {
-        dname = match_vec[0];
-
-        ref_ind = meta.ind_from_id(dname);
+        ref_ind = meta.ind_from_id(match_vec[0]);
 
-        dbegin = stoi(match_vec[1]);
-        dend = stoi(match_vec[2]);
+        dbegin = valik::parse_number<uint64_t>(match_vec[1]);
+        dend = valik::parse_number<uint64_t>(match_vec[2]);
 
-        percid = match_vec[3];
+        percid = valik::parse_number<float>(match_vec[3]);
+        percid_format = dictionary.format_of(match_vec[3], percid);
 
-        if (match_vec[4] == "minus")
+        if (std::string_view{match_vec[4]} == "minus")
             is_forward_match = false;
         
-        evalue = match_vec[5];
+        evalue = valik::parse_number<double>(match_vec[5]);
+        evalue_format = dictionary.format_of(match_vec[5], evalue);
         
-        qname = match_vec[6];
-        qbegin = stoi(match_vec[7]);
-        qend = stoi(match_vec[8]); 
+        qid = dictionary.query_id(match_vec[6]);
+        qbegin = valik::parse_number<uint64_t>(match_vec[7]);
+        qend = valik::parse_number<uint64_t>(match_vec[8]);
     }
 
     struct length_order
@@ -51,11 +68,11 @@ struct blast_match
 
     bool operator == (blast_match const & other) const
     {
-        if (dname == other.dname &&
+        if (ref_ind == other.ref_ind &&
             dbegin == other.dbegin &&
             dend == other.dend &&
             is_forward_match == other.is_forward_match &&
-            qname == other.qname &&
+            qid == other.qid &&
             qbegin == other.qbegin &&
             percid_is_equal_to(other.percid))
             return true;
@@ -97,45 +114,59 @@ struct blast_match
         }
     }
 
-    bool percid_is_equal_to(std::string const & other) const
+    bool percid_is_equal_to(float const other) const
     {
         float eps{0.001};
-        float this_percid = std::stof(percid);
-        float other_percid = std::stof(other);
-
-        return abs(this_percid - other_percid) < eps;
+        return std::abs(percid - other) < eps;
     }
 
-    std::string to_string() const
+    /**
+     * @brief Function that updates the ids after the dictionary of the match was merged into another one.
+     */
+    void translate(valik::id_translation const & translation)
     {
-        std::string match_str = dname;
-        match_str += "\t";
-        match_str += std::to_string(dbegin);
-        match_str += "\t";
-        match_str += std::to_string(dend);
-        match_str += "\t";
-        match_str += percid;
-
-        match_str += "\t";
-
-        if (is_forward_match)
-            match_str += "plus";
-        else
-            match_str += "minus";
+        translation.translate_query(qid);
+        translation.translate(percid_format);
+        translation.translate(evalue_format);
+    }
 
-        match_str += "\t";
-        match_str += evalue;
-        match_str += "\t";
-        
-        match_str += qname;
-        match_str += "\t";
+    /**
+     * @brief Function that passes the fields of a match to archive, e.g. to store matches column by column.
+     */
+    template <typename match_t, typename archive_t>
+        requires std::same_as<std::remove_const_t<match_t>, blast_match>
+    static void columns(match_t & match, archive_t && archive)
+    {
+        archive(match.ref_ind, match.dbegin, match.dend, match.percid, match.is_forward_match, match.qid,
+                match.qbegin, match.qend, match.evalue, match.percid_format.notation, match.percid_format.precision,
+                match.percid_format.verbatim_id, match.evalue_format.notation, match.evalue_format.precision,
+                match.evalue_format.verbatim_id);
+    }
 
-        match_str += std::to_string(qbegin);
-        match_str += "\t";
+    /**
+     * @brief Function that formats the match as a BLAST tabular line.
+     */
+    void write(valik::alignment_writer & out,
+               valik::custom::metadata const & meta,
+               valik::match_dictionary const & dictionary) const
+    {
+        out << meta.id_from_ind(ref_ind) << '\t' << dbegin << '\t' << dend << '\t';
+        out.write_number(percid, percid_format, dictionary);
+        out << (is_forward_match ? "\tplus\t" : "\tminus\t");
+        out.write_number(evalue, evalue_format, dictionary);
+        out << '\t' << dictionary.query_name(qid) << '\t' << qbegin << '\t' << qend << '\n';
+    }
 
-        match_str += std::to_string(qend);
-        match_str += "\n";
-        return match_str;
+    std::string to_string(valik::custom::metadata const & meta, valik::match_dictionary const & dictionary) const
+    {
+        std::ostringstream match_str;
+        {
+            valik::alignment_writer out(match_str, 0);
+            write(out, meta, dictionary);
+        }
+        return match_str.str();
     }
 
 };
+
+static_assert(std::is_trivially_copyable_v<blast_match>);
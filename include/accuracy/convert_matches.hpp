@@ -0,0 +1,12 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <argument_parsing/convert_arguments.hpp>
+
+/*! \brief Function that converts a GFF or BLAST tabular file into a sorted match cache.
+ *  \param arguments The command line arguments of the convert subcommand.
+ */
+void convert_matches(convert_arguments const & arguments);
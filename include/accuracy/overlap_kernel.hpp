@@ -0,0 +1,178 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define VALIK_HAS_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+namespace valik
+{
+
+/**
+ * @brief Number of matches that overlap_block compares at once.
+ */
+inline constexpr size_t overlap_block_size{8};
+
+/**
+ * @brief Positions of matches stored column by column, so that a block of matches can be loaded into vector registers.
+ */
+struct match_columns
+{
+    std::vector<uint64_t> dbegins{};
+    std::vector<uint64_t> dends{};
+    std::vector<uint64_t> qbegins{};
+    std::vector<uint64_t> qends{};
+
+    template <typename match_t>
+    void push_back(match_t const & match)
+    {
+        dbegins.push_back(match.dbegin);
+        dends.push_back(match.dend);
+        qbegins.push_back(match.qbegin);
+        qends.push_back(match.qend);
+    }
+
+    void reserve(size_t const size)
+    {
+        dbegins.reserve(size);
+        dends.reserve(size);
+        qbegins.reserve(size);
+        qends.reserve(size);
+    }
+};
+
+/**
+ * @brief Positions of the single match that a block of match_columns is compared with.
+ */
+struct overlap_probe
+{
+    uint64_t dbegin;
+    uint64_t dend;
+    uint64_t qbegin;
+    uint64_t qend;
+};
+
+namespace detail
+{
+
+/**
+ * @brief Function that computes the joint overlaps like matches_overlap_length, with the column matches on the left
+ *        and assuming that all matches are on the same query and strand.
+ */
+inline uint32_t scalar_overlap_block(match_columns const & columns,
+                                     size_t const first,
+                                     size_t const count,
+                                     overlap_probe const & probe,
+                                     int64_t const overlap,
+                                     int64_t * lengths)
+{
+    uint32_t hits{0};
+    for (size_t k{0}; k < count; k++)
+    {
+        size_t const i = first + k;
+        int64_t const d_overlap = (columns.dbegins[i] > probe.dbegin) ? (int64_t) (probe.dend - columns.dbegins[i])
+                                                                       : (int64_t) (columns.dends[i] - probe.dbegin);
+        int64_t const q_overlap = (columns.qbegins[i] > probe.qbegin) ? (int64_t) (probe.qend - columns.qbegins[i])
+                                                                       : (int64_t) (columns.qends[i] - probe.qbegin);
+        lengths[k] = std::min(d_overlap, q_overlap);
+        hits |= (uint32_t) (lengths[k] >= overlap) << k;
+    }
+    return hits;
+}
+
+#ifdef VALIK_HAS_AVX2_KERNEL
+/**
+ * @brief Overlap of four intervals with another interval, measured from the end of the interval that begins first to
+ *        the begin of the other one.
+ */
+__attribute__((target("avx2")))
+inline __m256i avx2_interval_overlap(uint64_t const * begins,
+                                     uint64_t const * ends,
+                                     __m256i const other_begin,
+                                     __m256i const other_end)
+{
+    __m256i const begin = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begins));
+    __m256i const end = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(ends));
+    return _mm256_blendv_epi8(_mm256_sub_epi64(end, other_begin),
+                              _mm256_sub_epi64(other_end, begin),
+                              _mm256_cmpgt_epi64(begin, other_begin));
+}
+
+/**
+ * @brief AVX2 version of scalar_overlap_block, which compares four matches per instruction.
+ *        Positions are compared as signed integers, which holds for positions below 2^63.
+ */
+__attribute__((target("avx2")))
+inline uint32_t avx2_overlap_block(match_columns const & columns,
+                                   size_t const first,
+                                   size_t const count,
+                                   overlap_probe const & probe,
+                                   int64_t const overlap,
+                                   int64_t * lengths)
+{
+    __m256i const probe_dbegin = _mm256_set1_epi64x(probe.dbegin);
+    __m256i const probe_dend = _mm256_set1_epi64x(probe.dend);
+    __m256i const probe_qbegin = _mm256_set1_epi64x(probe.qbegin);
+    __m256i const probe_qend = _mm256_set1_epi64x(probe.qend);
+    __m256i const threshold = _mm256_set1_epi64x(overlap);
+
+    uint32_t hits{0};
+    size_t k{0};
+    for (; k + 4 <= count; k += 4)
+    {
+        size_t const i = first + k;
+        __m256i const d_overlap = avx2_interval_overlap(&columns.dbegins[i], &columns.dends[i], probe_dbegin,
+                                                        probe_dend);
+        __m256i const q_overlap = avx2_interval_overlap(&columns.qbegins[i], &columns.qends[i], probe_qbegin,
+                                                        probe_qend);
+        __m256i const length = _mm256_blendv_epi8(d_overlap, q_overlap, _mm256_cmpgt_epi64(d_overlap, q_overlap));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lengths + k), length);
+
+        uint32_t const misses = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(threshold, length)));
+        hits |= (~misses & 0xFu) << k;
+    }
+
+    if (k < count)
+        hits |= scalar_overlap_block(columns, first + k, count - k, probe, overlap, lengths + k) << k;
+    return hits;
+}
+#endif
+
+} // namespace detail
+
+/**
+ * @brief Function that computes the joint overlaps of the probe with up to overlap_block_size consecutive matches of
+ *        columns, which all have to be on the same query and strand as the probe.
+ *
+ * The AVX2 kernel is used if the processor supports it, otherwise the scalar one.
+ *
+ * @param first     Position of the first match of the block in columns.
+ * @param count     Number of matches in the block, at most overlap_block_size.
+ * @param lengths   Receives the joint overlap of each match of the block.
+ * @return Bit mask of the matches of the block that overlap the probe by at least overlap.
+ */
+inline uint32_t overlap_block(match_columns const & columns,
+                              size_t const first,
+                              size_t const count,
+                              overlap_probe const & probe,
+                              int64_t const overlap,
+                              int64_t * lengths)
+{
+#ifdef VALIK_HAS_AVX2_KERNEL
+    static bool const has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx2)
+        return detail::avx2_overlap_block(columns, first, count, probe, overlap, lengths);
+#endif
+    return detail::scalar_overlap_block(columns, first, count, probe, overlap, lengths);
+}
+
+} // namespace valik
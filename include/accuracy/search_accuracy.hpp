@@ -4,26 +4,45 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <bit>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <tuple>
 #include <type_traits>
+#include <vector>
 
 #include <argument_parsing/accuracy_arguments.hpp>
 #include <accuracy/blast_match.hpp>
+#include <accuracy/overlap_kernel.hpp>
 
 #include <valik/split/metadata.hpp>
 #include <utilities/consolidate/stellar_match.hpp>
 #include <utilities/consolidate/io.hpp>
+#include <utilities/consolidate/external_sort.hpp>
 #include <utilities/consolidate/consolidate_matches.hpp>
+#include <utilities/consolidate/match_cache.hpp>
+#include <utilities/parallel.hpp>
+#include <utilities/radix_sort.hpp>
+#include <utilities/run_statistics.hpp>
 
 #include <seqan3/core/debug_stream.hpp>
 
 /*
- * @brief Assume that left_match and right_match are from the same reference database. 
+ * @brief Returns the joint overlap of two matches, i.e. the smaller of their overlaps in the reference and in the query.
+ *        It is negative if the matches are apart and the smallest int64_t if they are not on the same query and strand.
+ *        Assume that left_match and right_match are from the same reference database.
  */
 template <typename l_match_t, typename r_match_t>
-bool matches_overlap(l_match_t const & left_match, r_match_t const & right_match, size_t const overlap)
+int64_t matches_overlap_length(l_match_t const & left_match, r_match_t const & right_match)
 {
     //!TODO: add percid; evalue?
-    if ((left_match.qname == right_match.qname) && 
+    if ((left_match.qid == right_match.qid) && 
         (left_match.is_forward_match == right_match.is_forward_match))
     {
 
@@ -54,31 +73,380 @@ bool matches_overlap(l_match_t const & left_match, r_match_t const & right_match
 
         auto dbegins_before = dinterval(true);
         auto dbegins_later = dinterval(false);
+        auto qbegins_before = qinterval(true);
+        auto qbegins_later = qinterval(false);
+        return std::min((int64_t) (dbegins_before.second - dbegins_later.first),
+                        (int64_t) (qbegins_before.second - qbegins_later.first));
+    }
+    else
+        return std::numeric_limits<int64_t>::min();
+}
+
+/*
+ * @brief Assume that left_match and right_match are from the same reference database. 
+ */
+template <typename l_match_t, typename r_match_t>
+bool matches_overlap(l_match_t const & left_match, r_match_t const & right_match, size_t const overlap)
+{
+    return matches_overlap_length(left_match, right_match) >= (int64_t) overlap;
+}
+
+/*
+ * @brief Truth matches grouped by reference, query and strand, which are the only matches that can overlap each other.
+ *
+ * Each group is sorted by dbegin and keeps the running maximum of dend. A test match is only compared with its own
+ * group: truth matches that begin at or after it are reachable while their start is close enough to its end, truth
+ * matches that begin before it are reachable while the running maximum end is far enough from its start. Both bounds
+ * are found by binary search and the positions in between are compared in blocks with overlap_block.
+ * Neither the truth nor the test matches have to be sorted.
+ */
+template <typename truth_match_t>
+class truth_interval_index
+{
+public:
+    explicit truth_interval_index(std::vector<truth_match_t> const & truth)
+    {
+        truth_indices.resize(truth.size());
+        std::iota(truth_indices.begin(), truth_indices.end(), size_t{0});
+        std::ranges::stable_sort(truth_indices, std::less<>{}, [&](size_t const i)
+        {
+            return std::make_tuple(key_of(truth[i]), truth[i].dbegin);
+        });
 
-        if ((int64_t) (dbegins_before.second - dbegins_later.first) >= (int64_t) overlap)
+        columns.reserve(truth.size());
+        max_dends.reserve(truth.size());
+        for (size_t const i : truth_indices)
         {
-            auto qbegins_before = qinterval(true);
-            auto qbegins_later = qinterval(false);
-            if ((int64_t)(qbegins_before.second - qbegins_later.first) >= (int64_t) overlap)
+            bucket_key const key = key_of(truth[i]);
+            if (keys.empty() || keys.back() != key)
             {
-                return true;
+                keys.push_back(key);
+                bucket_begins.push_back(max_dends.size());
             }
+            uint64_t const previous_max = (bucket_begins.back() == max_dends.size()) ? 0 : max_dends.back();
+            columns.push_back(truth[i]);
+            max_dends.push_back(std::max<uint64_t>(previous_max, truth[i].dend));
+        }
+        bucket_begins.push_back(max_dends.size());
+    }
+
+    /*
+     * @brief Calls on_overlap(truth_ind, length) for every truth match that overlaps test_match by at least overlap,
+     *        where length is their joint overlap.
+     */
+    template <typename test_match_t, typename callback_t>
+    void for_each_overlap(test_match_t const & test_match, size_t const overlap, callback_t && on_overlap) const
+    {
+        auto const key_it = std::ranges::lower_bound(keys, key_of(test_match));
+        if (key_it == keys.end() || *key_it != key_of(test_match))
+            return;
+
+        size_t const bucket = std::distance(keys.begin(), key_it);
+        auto const & dbegins = columns.dbegins;
+        size_t const first_later = std::distance(dbegins.begin(),
+                                                 std::lower_bound(dbegins.begin() + bucket_begins[bucket],
+                                                                  dbegins.begin() + bucket_begins[bucket + 1],
+                                                                  test_match.dbegin));
+
+        // truth matches that begin at the same position are the earlier match of the pair
+        size_t const end = partition_position(first_later, bucket_begins[bucket + 1], [&](size_t const pos)
+        {
+            return (dbegins[pos] == test_match.dbegin) ||
+                   ((int64_t) (test_match.dend - dbegins[pos]) >= (int64_t) overlap);
+        });
+        size_t const begin = partition_position(bucket_begins[bucket], first_later, [&](size_t const pos)
+        {
+            return (int64_t) (max_dends[pos] - test_match.dbegin) < (int64_t) overlap;
+        });
+
+        valik::overlap_probe const probe{test_match.dbegin, test_match.dend, test_match.qbegin, test_match.qend};
+        std::array<int64_t, valik::overlap_block_size> lengths;
+        for (size_t first = begin; first < end; first += lengths.size())
+        {
+            size_t const count = std::min(lengths.size(), end - first);
+            for (uint32_t hits = valik::overlap_block(columns, first, count, probe, overlap, lengths.data()); hits;
+                 hits &= hits - 1)
+            {
+                size_t const k = std::countr_zero(hits);
+                on_overlap(truth_indices[first + k], lengths[k]);
+            }
+        }
+    }
+
+private:
+    using bucket_key = std::tuple<size_t, uint32_t, bool>; // (ref_ind, qid, is_forward_match)
+
+    template <typename match_t>
+    static bucket_key key_of(match_t const & match)
+    {
+        return std::make_tuple(match.ref_ind, match.qid, match.is_forward_match);
+    }
+
+    /*
+     * @brief Returns the first position in [first, last) for which is_before is false, like std::partition_point.
+     */
+    template <typename predicate_t>
+    static size_t partition_position(size_t first, size_t last, predicate_t && is_before)
+    {
+        while (first < last)
+        {
+            size_t const middle = first + (last - first) / 2;
+            if (is_before(middle))
+                first = middle + 1;
             else
-                return false;
+                last = middle;
         }
+        return first;
+    }
+
+    std::vector<bucket_key> keys{};
+    std::vector<size_t> bucket_begins{};    // positions of the groups in the arrays below and the total size
+    std::vector<size_t> truth_indices{};
+    valik::match_columns columns{};
+    std::vector<uint64_t> max_dends{};      // largest dend of the group up to and including the position
+};
+
+/*
+ * @brief Merge-joins two streams of alignments that are sorted by reference and position.
+ *
+ * Calls on_truth_done(match, found) and on_test_done(match, found) for every match once it can not overlap any match
+ * that is still to come. Matches are passed on in input order and found is true if the match overlaps at least one
+ * match of the other stream by min_overlap. Only matches that can still be reached are kept in memory.
+ */
+template <typename truth_reader_t, typename test_reader_t, typename truth_done_t, typename test_done_t>
+void stream_overlapping_matches(truth_reader_t & truth_reader,
+                                test_reader_t & test_reader,
+                                size_t const overlap,
+                                valik::match_dictionary & dictionary,
+                                truth_done_t && on_truth_done,
+                                test_done_t && on_test_done)
+{
+    using truth_match_t = typename decltype(truth_reader.next())::value_type;
+    using test_match_t = typename decltype(test_reader.next())::value_type;
+
+    auto read_sorted = [](auto & reader, auto const & previous, std::string const & name)
+    {
+        auto match = reader.next();
+        if (match && (std::make_pair(match->ref_ind, match->dbegin) < std::make_pair(previous.ref_ind, previous.dbegin)))
+            throw std::runtime_error{name + " alignments are not sorted by reference and position. "
+                                     "Evaluate them without --streaming."};
+        return match;
+    };
+
+    // a windowed match can still overlap a later match that begins at the same position or before its end
+    auto can_reach = [&](auto const & windowed_match, auto const & next_match)
+    {
+        return (windowed_match.ref_ind == next_match.ref_ind) &&
+               ((windowed_match.dbegin == next_match.dbegin) ||
+                ((int64_t) (windowed_match.dend - next_match.dbegin) >= (int64_t) overlap));
+    };
+
+    auto retire = [&](auto & window, auto const & next_match, auto && on_done)
+    {
+        while (!window.empty() && !can_reach(window.front().first, next_match))
+        {
+            on_done(window.front().first, window.front().second);
+            window.pop_front();
+        }
+    };
+
+    auto text_offset = [](auto const & match) -> uint64_t
+    {
+        if constexpr (requires { match.alignment_attributes; })
+            return match.alignment_attributes.offset;
         else
-            return false;
+            return std::numeric_limits<uint64_t>::max();
+    };
+
+    std::deque<std::pair<truth_match_t, bool>> truth_window{};
+    std::deque<std::pair<test_match_t, bool>> test_window{};
+    std::optional<truth_match_t> next_truth = truth_reader.next();
+    std::optional<test_match_t> next_test = test_reader.next();
+    while (next_truth || next_test)
+    {
+        if (next_truth && (!next_test || (std::make_pair(next_truth->ref_ind, next_truth->dbegin) <=
+                                          std::make_pair(next_test->ref_ind, next_test->dbegin))))
+        {
+            truth_match_t const true_match = *next_truth;
+            next_truth = read_sorted(truth_reader, true_match, "Truth");
+            retire(truth_window, true_match, on_truth_done);
+            retire(test_window, true_match, on_test_done);
+
+            bool found{false};
+            for (auto & [test_match, test_found] : test_window)
+            {
+                if (matches_overlap(true_match, test_match, overlap))
+                    found = test_found = true;
+            }
+            truth_window.emplace_back(true_match, found);
+        }
+        else
+        {
+            test_match_t const test_match = *next_test;
+            next_test = read_sorted(test_reader, test_match, "Test");
+            retire(truth_window, test_match, on_truth_done);
+            retire(test_window, test_match, on_test_done);
+
+            bool found{false};
+            for (auto & [true_match, true_found] : truth_window)
+            {
+                if (matches_overlap(true_match, test_match, overlap))
+                    found = true_found = true;
+            }
+            test_window.emplace_back(test_match, found);
+        }
+
+        // windows and pending matches hold the text that was stored last
+        uint64_t oldest_text = std::numeric_limits<uint64_t>::max();
+        if (!truth_window.empty())
+            oldest_text = std::min(oldest_text, text_offset(truth_window.front().first));
+        if (!test_window.empty())
+            oldest_text = std::min(oldest_text, text_offset(test_window.front().first));
+        if (next_truth)
+            oldest_text = std::min(oldest_text, text_offset(*next_truth));
+        if (next_test)
+            oldest_text = std::min(oldest_text, text_offset(*next_test));
+        if (oldest_text != std::numeric_limits<uint64_t>::max())
+            dictionary.discard_text_before(oldest_text);
     }
-    else
-        return false;
+
+    for (auto const & [true_match, found] : truth_window)
+        on_truth_done(true_match, found);
+    for (auto const & [test_match, found] : test_window)
+        on_test_done(test_match, found);
+}
+
+/*
+ * @brief Outcome of an evaluation as indices into the truth and test matches it was computed from.
+ */
+struct accuracy_result
+{
+    uint64_t true_positive_count{0};
+    std::vector<size_t> false_negatives{}; // truth matches that no test match overlaps
+    std::vector<size_t> false_positives{}; // test matches that overlap no truth match
+};
+
+/*
+ * @brief Finds the truth matches that are missed by the test matches and the test matches that are not in the truth
+ *        for each of several overlap thresholds.
+ *
+ * The truth matches are indexed with truth_interval_index and blocks of test matches probe the index on up to
+ * thread_count threads. The matches are compared once with the smallest threshold and the longest joint overlap of
+ * each match is kept, so that every threshold only adds a counting pass.
+ *
+ * @return One result per threshold in the order of overlaps.
+ */
+template <typename truth_match_t, typename test_match_t>
+std::vector<accuracy_result> evaluate_accuracy(std::vector<truth_match_t> const & truth,
+                                               std::vector<test_match_t> const & test,
+                                               std::vector<size_t> const & overlaps,
+                                               size_t const thread_count)
+{
+    if (overlaps.empty())
+        return {};
+
+    truth_interval_index const index(truth);
+
+    // Each test match is probed by one thread, but a truth match can be found from several blocks.
+    std::vector<int64_t> test_overlap_lengths(test.size(), std::numeric_limits<int64_t>::min());
+    std::vector<int64_t> truth_overlap_lengths(truth.size(), std::numeric_limits<int64_t>::min());
+    size_t const min_overlap = *std::ranges::min_element(overlaps);
+    size_t const block_size{1024};
+    valik::work_stealing_for((test.size() + block_size - 1) / block_size, thread_count, [&](size_t const block)
+    {
+        for (size_t j = block * block_size; j < std::min(test.size(), (block + 1) * block_size); j++)
+        {
+            index.for_each_overlap(test[j], min_overlap, [&](size_t const truth_ind, int64_t const length)
+            {
+                std::atomic_ref<int64_t> truth_length(truth_overlap_lengths[truth_ind]);
+                int64_t longest = truth_length.load(std::memory_order_relaxed);
+                while (longest < length &&
+                       !truth_length.compare_exchange_weak(longest, length, std::memory_order_relaxed))
+                {}
+
+                test_overlap_lengths[j] = std::max(test_overlap_lengths[j], length);
+            });
+        }
+    });
+
+    std::vector<accuracy_result> results(overlaps.size());
+    for (size_t t{0}; t < overlaps.size(); t++)
+    {
+        int64_t const overlap = overlaps[t];
+        accuracy_result & result = results[t];
+        for (size_t i{0}; i < truth.size(); i++)
+        {
+            if (truth_overlap_lengths[i] < overlap)
+                result.false_negatives.push_back(i);
+        }
+
+        for (size_t i{0}; i < test.size(); i++)
+        {
+            if (test_overlap_lengths[i] < overlap)
+                result.false_positives.push_back(i);
+            else
+                result.true_positive_count++;
+        }
+    }
+
+    return results;
+}
+
+/*
+ * @brief Finds the truth matches that are missed by the test matches and the test matches that are not in the truth.
+ */
+template <typename truth_match_t, typename test_match_t>
+accuracy_result evaluate_accuracy(std::vector<truth_match_t> const & truth,
+                                  std::vector<test_match_t> const & test,
+                                  size_t const overlap,
+                                  size_t const thread_count)
+{
+    return std::move(evaluate_accuracy(truth, test, std::vector<size_t>{overlap}, thread_count).front());
 }
 
+/*
+ * @brief Returns a view of the matches at the given indices, e.g. the false positives of an accuracy_result.
+ */
+template <typename match_t>
+auto gather_matches(std::vector<match_t> const & matches, std::vector<size_t> const & indices)
+{
+    return indices | std::views::transform([&matches](size_t const i) -> match_t const &
+    {
+        return matches[i];
+    });
+}
+
+/*
+ * @brief Function that reads alignments and sorts them, unless the file is sorted already.
+ *        Match caches are loaded without parsing or sorting.
+ *
+ * @param statistics    Receives the "<role> parse" and "<role> sort" phases, if it is not null.
+ */
 template <typename match_t>
-auto get_sorted_alignments(std::filesystem::path const & in, valik::custom::metadata const & meta)
+auto get_sorted_alignments(std::filesystem::path const & in,
+                           valik::custom::metadata const & meta,
+                           valik::match_dictionary & dictionary,
+                           size_t const thread_count = 1,
+                           valik::run_statistics * const statistics = nullptr,
+                           std::string const & role = "alignments")
 {
-    auto alignments = valik::read_alignment_output<match_t>(in, meta);
-    std::sort(alignments.begin(), alignments.end(), std::less<match_t>()); 
-    return alignments;
+    valik::phase_timer parse_timer(statistics, role + " parse", in.string());
+    if (valik::is_match_cache(in))
+    {
+        auto matches = valik::read_match_cache<match_t>(in, meta, dictionary);
+        parse_timer.stop(matches.size(), std::filesystem::file_size(in));
+        return matches;
+    }
+
+    auto loaded = valik::load_alignments<match_t>(in, meta, dictionary, std::ios_base::in, thread_count);
+    parse_timer.stop(loaded.matches.size(), std::filesystem::file_size(in));
+    if (!loaded.is_sorted)
+    {
+        valik::phase_timer sort_timer(statistics, role + " sort", in.string());
+        valik::sort_matches(loaded.matches, thread_count);
+        sort_timer.stop(loaded.matches.size(), loaded.matches.size() * sizeof(match_t));
+    }
+    return std::vector<match_t>{std::move(loaded.matches)};
 }
 
 /*! \brief Function that find the number of overlapping alignments.
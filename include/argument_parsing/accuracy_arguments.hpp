@@ -10,13 +10,17 @@
 struct accuracy_arguments
 {
     std::filesystem::path truth_file{};
-    std::filesystem::path test_file{};
+    std::vector<std::filesystem::path> test_files{};
     std::filesystem::path ref_meta{};
     size_t min_len{150};
-    size_t min_overlap{50};
+    std::vector<size_t> min_overlaps{50}; // sorted and unique
     double error_rate{0.025};
     size_t numMatches{0};
     size_t disableThresh{std::numeric_limits<size_t>::max()};
-    std::filesystem::path out;
+    std::filesystem::path out; // empty if several test files are written next to themselves
+    size_t threads{1};
+    bool streaming{};
+    size_t memory_limit{0}; // bytes, 0 sorts in memory
     bool verbose{};
+    std::filesystem::path stats_json{}; // empty if no statistics are collected
 };
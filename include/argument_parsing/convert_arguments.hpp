@@ -0,0 +1,16 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <filesystem>
+
+struct convert_arguments
+{
+    std::filesystem::path input_file{};
+    std::filesystem::path ref_meta{};
+    std::filesystem::path out{};
+    size_t threads{1};
+    bool verbose{};
+};
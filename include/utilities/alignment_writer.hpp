@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <utilities/match_dictionary.hpp>
+
+namespace valik
+{
+
+/**
+ * @brief Formats alignment records into a reusable buffer and passes it on to a stream in large writes.
+ *
+ * Numbers are formatted in place with std::to_chars, so writing a record does not allocate.
+ * The buffer is flushed when it runs full and when the writer is destroyed.
+ */
+class alignment_writer
+{
+public:
+    alignment_writer(alignment_writer const &) = delete;
+    alignment_writer & operator=(alignment_writer const &) = delete;
+
+    /**
+     * @param out           Stream that receives the formatted records.
+     * @param buffer_size   Number of bytes that are collected before they are written to out.
+     */
+    explicit alignment_writer(std::ostream & out, size_t const buffer_size = 1ULL << 20) :
+        out{out}, buffer(std::max(buffer_size, min_buffer_size))
+    {}
+
+    ~alignment_writer()
+    {
+        flush();
+    }
+
+    alignment_writer & operator<<(std::string_view const text)
+    {
+        if (buffer.size() - used < text.size())
+        {
+            flush();
+            if (buffer.size() < text.size())
+            {
+                out.write(text.data(), text.size());
+                return *this;
+            }
+        }
+
+        std::memcpy(buffer.data() + used, text.data(), text.size());
+        used += text.size();
+        return *this;
+    }
+
+    alignment_writer & operator<<(char const c)
+    {
+        reserve(1);
+        buffer[used++] = c;
+        return *this;
+    }
+
+    template <typename number_t>
+        requires std::is_integral_v<number_t>
+    alignment_writer & operator<<(number_t const value)
+    {
+        reserve(std::numeric_limits<number_t>::digits10 + 2);
+        auto [end, error] = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value);
+        used = end - buffer.data();
+        return *this;
+    }
+
+    /**
+     * @brief Function that writes a floating point number in the format it was read in.
+     */
+    template <typename number_t>
+        requires std::is_floating_point_v<number_t>
+    void write_number(number_t const value, number_format const format, match_dictionary const & dictionary)
+    {
+        if (format.notation == number_format::style::verbatim)
+        {
+            *this << dictionary.number_text(value, format, std::span<char>{});
+            return;
+        }
+
+        reserve(match_dictionary::max_number_length);
+        used += dictionary.number_text(value, format, std::span<char>{buffer.data() + used, buffer.size() - used}).size();
+    }
+
+    /**
+     * @brief Function that passes the buffered records on to the stream.
+     */
+    void flush()
+    {
+        if (used > 0)
+            out.write(buffer.data(), used);
+        used = 0;
+    }
+
+private:
+    static constexpr size_t min_buffer_size{2 * match_dictionary::max_number_length};
+
+    std::ostream & out;
+    std::vector<char> buffer;
+    size_t used{0};
+
+    void reserve(size_t const length)
+    {
+        if (buffer.size() - used < length)
+            flush();
+    }
+};
+
+} // namespace valik
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <filesystem>
+#include <numeric>
 #include <unordered_map>
 #include <ranges>
 
@@ -18,8 +19,15 @@
 namespace valik::custom
 {
 
-void consolidate_matches(std::vector<stellar_match> & matches, accuracy_arguments const & arguments);
+/**
+ * @brief Function that removes matches of queries that appear too often. The remaining matches keep their order.
+ */
+void consolidate_matches(std::vector<stellar_match> & matches,
+                         match_dictionary const & dictionary,
+                         accuracy_arguments const & arguments);
 
-void consolidate_matches(std::vector<blast_match> & matches, accuracy_arguments const & arguments);
+void consolidate_matches(std::vector<blast_match> & matches,
+                         match_dictionary const & dictionary,
+                         accuracy_arguments const & arguments);
 
 } // namespace valik::custom
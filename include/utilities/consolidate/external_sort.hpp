@@ -0,0 +1,264 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <valik/split/metadata.hpp>
+#include <utilities/consolidate/io.hpp>
+#include <utilities/match_dictionary.hpp>
+#include <utilities/radix_sort.hpp>
+
+namespace valik
+{
+
+/**
+ * @brief Function that returns a path in the temporary directory that is unique within this process.
+ */
+inline std::filesystem::path unique_temporary_path(std::string const & extension)
+{
+    static std::atomic<size_t> path_count{0};
+    return std::filesystem::temp_directory_path() /
+           ("valik_evaluate_" + std::to_string(getpid()) + "_" + std::to_string(path_count++) + extension);
+}
+
+/**
+ * @brief Paths of temporary files, which are removed when it is destroyed.
+ */
+struct temporary_files
+{
+    std::vector<std::filesystem::path> paths{};
+
+    temporary_files() = default;
+    temporary_files(temporary_files const &) = delete;
+    temporary_files & operator=(temporary_files const &) = delete;
+
+    ~temporary_files()
+    {
+        std::error_code ec{};
+        for (auto const & path : paths)
+            std::filesystem::remove(path, ec);
+    }
+};
+
+/**
+ * @brief Reads alignments in (ref_ind, dbegin, dend) order from an unsorted file with bounded memory.
+ *
+ * The file is cut into runs that fit into the memory limit. Each run is sorted and spilled to a temporary file as
+ * binary records: the fields that match_t::columns lists, without the padding of the struct, followed by its pooled
+ * text, if it has any. The runs are then merged with a k-way merge. If the whole file fits into a single run, the run
+ * is kept in memory.
+ *
+ * Text of returned matches is stored in the dictionary in the order the matches are returned, so that a consumer
+ * can release it with match_dictionary::discard_text_before.
+ */
+template <typename match_t>
+class sorted_alignment_reader
+{
+    static_assert(std::is_trivially_copyable_v<match_t>);
+
+public:
+    /**
+     * @param match_path    Unsorted alignment file.
+     * @param meta          Reference metadata.
+     * @param dictionary    Dictionary that is shared by all inputs of an evaluation.
+     * @param memory_limit  Approximate number of bytes that a run may take up.
+     */
+    sorted_alignment_reader(std::filesystem::path const & match_path,
+                            valik::custom::metadata const & meta,
+                            match_dictionary & dictionary,
+                            size_t const memory_limit) : dictionary(dictionary)
+    {
+        alignment_reader<match_t> reader(match_path, meta, dictionary);
+        std::vector<match_t> run{};
+        size_t run_bytes{0};
+        bool run_is_sorted{true};
+        bool more_input{true};
+        while (more_input)
+        {
+            std::optional<match_t> match = reader.next();
+            more_input = match.has_value();
+            if (more_input)
+            {
+                input_count++;
+                run_is_sorted &= (run.empty() || !(*match < run.back()));
+                run.push_back(*match);
+                run_bytes += sizeof(match_t) + text_of(*match).size();
+            }
+
+            if ((!more_input && !run.empty()) || run_bytes >= memory_limit)
+            {
+                spill(run, run_is_sorted, !more_input && runs.empty());
+                run.clear();
+                run_bytes = 0;
+                run_is_sorted = true;
+            }
+        }
+
+        for (size_t run_ind{0}; run_ind < runs.size(); run_ind++)
+            advance(run_ind);
+    }
+
+    sorted_alignment_reader(sorted_alignment_reader const &) = delete;
+    sorted_alignment_reader & operator=(sorted_alignment_reader const &) = delete;
+    ~sorted_alignment_reader() = default;
+
+    /**
+     * @brief Function that returns the next alignment in sorted order or nothing if all runs are exhausted.
+     */
+    std::optional<match_t> next()
+    {
+        if (heads.empty())
+            return std::nullopt;
+
+        size_t const run_ind = heads.top().second;
+        match_t match = heads.top().first;
+        heads.pop();
+        if constexpr (has_text)
+            match.alignment_attributes = dictionary.store(run_texts[run_ind]);
+
+        advance(run_ind);
+        return match;
+    }
+
+    /**
+     * @brief Number of runs the input was cut into.
+     */
+    size_t run_count() const
+    {
+        return runs.size();
+    }
+
+    /**
+     * @brief Number of alignments in the input.
+     */
+    size_t match_count() const
+    {
+        return input_count;
+    }
+
+private:
+    static constexpr bool has_text = requires (match_t match) { match.alignment_attributes; };
+
+    using head_t = std::pair<match_t, size_t>;
+
+    struct head_order
+    {
+        // std::priority_queue returns the largest element first; ties are resolved in run order
+        bool operator()(head_t const & left, head_t const & right) const
+        {
+            if (left.first < right.first)
+                return false;
+            if (right.first < left.first)
+                return true;
+            return left.second > right.second;
+        }
+    };
+
+    match_dictionary & dictionary;
+    // the files are closed before they are removed, also if the constructor throws
+    temporary_files spill_files{};
+    std::vector<std::unique_ptr<std::iostream>> runs{};
+    size_t input_count{0};
+    std::vector<std::string> run_texts{};
+    std::priority_queue<head_t, std::vector<head_t>, head_order> heads{};
+
+    std::string_view text_of(match_t const & match) const
+    {
+        if constexpr (has_text)
+            return dictionary.text(match.alignment_attributes);
+        else
+            return std::string_view{};
+    }
+
+    /**
+     * @brief Function that sorts a run, unless it is sorted already, and writes it to a temporary file, or into
+     * memory if it is the only run.
+     */
+    void spill(std::vector<match_t> & run, bool const is_sorted, bool const is_only_run)
+    {
+        if (!is_sorted)
+            sort_matches(run);
+
+        if (is_only_run)
+        {
+            runs.push_back(std::make_unique<std::stringstream>(std::ios::in | std::ios::out | std::ios::binary));
+        }
+        else
+        {
+            std::filesystem::path const & spill_path = spill_files.paths.emplace_back(unique_temporary_path(".bin"));
+            auto file = std::make_unique<std::fstream>(spill_path, std::ios::in | std::ios::out | std::ios::trunc |
+                                                                   std::ios::binary);
+            if (!file->is_open())
+                throw std::runtime_error{"Could not create temporary file " + spill_path.string()};
+            runs.push_back(std::move(file));
+        }
+
+        auto & out = *runs.back();
+        for (auto const & match : run)
+        {
+            // the length of the text is a field of its span
+            match_t::columns(match, [&](auto const & ... fields)
+            {
+                (out.write(reinterpret_cast<char const *>(&fields), sizeof(fields)), ...);
+            });
+            std::string_view const text = text_of(match);
+            out.write(text.data(), text.size());
+        }
+
+        out.flush();
+        if (!out)
+            throw std::runtime_error{"Could not write sorted run of alignments."};
+        out.seekg(0);
+
+        // the run holds its own copy of the text now
+        dictionary.discard_text_before(std::numeric_limits<uint64_t>::max());
+        run_texts.emplace_back();
+    }
+
+    /**
+     * @brief Function that reads the next record of a run into the merge heap.
+     */
+    void advance(size_t const run_ind)
+    {
+        auto & in = *runs[run_ind];
+        if (in.peek() == std::char_traits<char>::eof())
+            return;
+
+        auto match = std::bit_cast<match_t>(std::array<std::byte, sizeof(match_t)>{});
+        match_t::columns(match, [&](auto & ... fields)
+        {
+            (in.read(reinterpret_cast<char *>(&fields), sizeof(fields)), ...);
+        });
+
+        if constexpr (has_text)
+        {
+            run_texts[run_ind].resize(match.alignment_attributes.length);
+            in.read(run_texts[run_ind].data(), match.alignment_attributes.length);
+        }
+
+        if (!in)
+            throw std::runtime_error{"Sorted run of alignments is truncated."};
+
+        heads.emplace(match, run_ind);
+    }
+};
+
+} // namespace valik
@@ -4,43 +4,331 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <exception>
 #include <filesystem>
+#include <fstream>
+#include <optional>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
 
 #include <valik/split/metadata.hpp>
+#include <utilities/alignment_writer.hpp>
+#include <utilities/mapped_file.hpp>
+#include <utilities/match_dictionary.hpp>
+#include <utilities/parallel.hpp>
 #include <utilities/shared.hpp>
 
 namespace valik
 {
 
+/**
+ * @brief Function that estimates the number of lines in a text from the newline density of its beginning.
+ */
+inline size_t estimate_line_count(std::string_view const text)
+{
+    std::string_view const sample = text.substr(0, 1ULL << 20);
+    size_t const sample_lines = std::ranges::count(sample, '\n') + 1;
+    return text.size() * sample_lines / sample.size();
+}
+
+/**
+ * @brief Function that calls on_line for each line of a text without copying it. The newline is not part of the line.
+ */
+template <typename callback_t>
+void for_each_line(std::string_view text, callback_t && on_line)
+{
+    while (!text.empty())
+    {
+        size_t line_end = text.find('\n');
+        if (line_end == std::string_view::npos)
+            line_end = text.size();
+
+        if (!on_line(text.substr(0, line_end)))
+            return;
+
+        text.remove_prefix(std::min(line_end + 1, text.size()));
+    }
+}
+
+/**
+ * @brief Function that returns whether a line holds an alignment record with field_count fields.
+ *
+ * Empty lines are skipped. Lines that are neither empty nor one of the workaround lines with a single field have to
+ * have all columns, because the fields of a shorter line would be mixed with those of the line before it.
+ */
+template <size_t column_count>
+bool is_alignment_record(std::string_view const line, size_t const field_count)
+{
+    if (field_count == 0)
+        return false;
+
+    if (field_count != column_count)
+        throw std::runtime_error{"Malformed record: expected " + std::to_string(column_count) + " tab-separated "
+                                 "fields but found " + std::to_string(field_count) + " in line '" +
+                                 std::string{line} + "'."};
+    return true;
+}
+
+/**
+ * @brief Alignments in the order they were read and whether that order is sorted by (ref_ind, dbegin, dend).
+ */
 template <typename match_t>
-std::vector<match_t> read_alignment_output(std::filesystem::path const & match_path,
+struct loaded_alignments
+{
+    std::vector<match_t> matches{};
+    bool is_sorted{true};
+};
+
+/**
+ * @brief Function that parses the lines of a text until a line is not an alignment.
+ *
+ * @param is_sorted Set to false if a parsed alignment is smaller than the one before it.
+ * @return Whether all lines were alignments.
+ */
+template <typename match_t>
+bool parse_alignments(std::string_view const text,
+                      std::vector<match_t> & matches,
+                      valik::custom::metadata const & meta,
+                      match_dictionary & dictionary,
+                      bool & is_sorted)
+{
+    std::array<std::string_view, 9> line_vec; // Stellar GFF format output has 9 columns
+    bool complete{true};
+    size_t const first_new = matches.size();
+    for_each_line(text, [&](std::string_view const line)
+    {
+        size_t const field_count = split_line(line, '\t', line_vec);
+
+        //!WORKAROUND: for valik_search_segments test that writes output file names instead of matches
+        if (field_count == 1)
+            return complete = false;
+
+        if (!is_alignment_record<std::tuple_size_v<decltype(line_vec)>>(line, field_count))
+            return true;
+
+        matches.emplace_back(line_vec, meta, dictionary);
+        if (matches.size() > first_new + 1)
+            is_sorted &= !(matches.back() < matches[matches.size() - 2]);
+        return true;
+    });
+    return complete;
+}
+
+/**
+ * @brief Function that parses a text in chunks of whole lines on up to thread_count threads.
+ *
+ * Each chunk is parsed with its own dictionary. The chunks are concatenated in order and their dictionaries are
+ * merged into dictionary, so the result is the same as parsing the text in one piece. The order is checked within
+ * each chunk and across the chunk borders. Lines after the first one that is not an alignment are ignored like in
+ * the sequential parse, so errors of chunks after it are discarded.
+ *
+ * @param min_chunk_size Texts are not cut into chunks that are smaller than this many bytes.
+ */
+template <typename match_t>
+loaded_alignments<match_t> parse_alignments_parallel(std::string_view const text,
+                                               valik::custom::metadata const & meta,
+                                               match_dictionary & dictionary,
+                                               size_t const thread_count,
+                                               size_t const min_chunk_size = 1ULL << 20)
+{
+    size_t const chunk_count = std::min(thread_count * 4, std::max<size_t>(text.size() / min_chunk_size, 1));
+    std::vector<std::string_view> chunks{};
+    size_t chunk_begin{0};
+    for (size_t c{1}; c <= chunk_count && chunk_begin < text.size(); c++)
+    {
+        size_t chunk_end = text.size();
+        if (c < chunk_count)
+        {
+            chunk_end = text.find('\n', std::max(chunk_begin, text.size() * c / chunk_count));
+            chunk_end = (chunk_end == std::string_view::npos) ? text.size() : chunk_end + 1;
+        }
+        chunks.push_back(text.substr(chunk_begin, chunk_end - chunk_begin));
+        chunk_begin = chunk_end;
+    }
+
+    std::vector<std::vector<match_t>> chunk_matches(chunks.size());
+    std::vector<match_dictionary> chunk_dictionaries(chunks.size());
+    std::vector<uint8_t> chunk_complete(chunks.size(), 0);
+    std::vector<uint8_t> chunk_sorted(chunks.size(), 0);
+    std::vector<std::exception_ptr> chunk_errors(chunks.size());
+    parallel_for(chunks.size(), thread_count, [&](size_t const c)
+    {
+        try
+        {
+            bool is_sorted{true};
+            chunk_matches[c].reserve(estimate_line_count(chunks[c]));
+            chunk_complete[c] = parse_alignments(chunks[c], chunk_matches[c], meta, chunk_dictionaries[c], is_sorted);
+            chunk_sorted[c] = is_sorted;
+        }
+        catch (...)
+        {
+            chunk_errors[c] = std::current_exception();
+        }
+    });
+
+    loaded_alignments<match_t> loaded{};
+    auto & matches = loaded.matches;
+    size_t match_count{0};
+    for (size_t c{0}; c < chunks.size(); c++)
+    {
+        if (chunk_errors[c])
+            std::rethrow_exception(chunk_errors[c]);
+        match_count += chunk_matches[c].size();
+        if (!chunk_complete[c])
+            break;
+    }
+    matches.reserve(match_count);
+
+    for (size_t c{0}; c < chunks.size(); c++)
+    {
+        loaded.is_sorted &= chunk_sorted[c];
+        if (!chunk_matches[c].empty() && !matches.empty())
+            loaded.is_sorted &= !(chunk_matches[c].front() < matches.back());
+
+        id_translation const translation = dictionary.merge(chunk_dictionaries[c]);
+        for (auto & match : chunk_matches[c])
+        {
+            match.translate(translation);
+            matches.push_back(match);
+        }
+        std::vector<match_t>{}.swap(chunk_matches[c]);
+
+        // lines after one that is not an alignment are ignored
+        if (!chunk_complete[c])
+            break;
+    }
+
+    return loaded;
+}
+
+/**
+ * @brief Function that reads alignments in file order and checks whether they are sorted while parsing them.
+ */
+template <typename match_t>
+loaded_alignments<match_t> load_alignments(std::filesystem::path const & match_path,
                                            valik::custom::metadata const & meta,
-                                           std::ios_base::openmode const mode = std::ios_base::in)
+                                           match_dictionary & dictionary,
+                                           std::ios_base::openmode const mode = std::ios_base::in,
+                                           size_t const thread_count = 1)
 {
-    std::vector<match_t> matches;
-    std::ifstream fin(match_path, mode);
+    loaded_alignments<match_t> loaded{};
+    auto & matches = loaded.matches;
+    mapped_file const mapped(match_path);
+    if (mapped.is_mapped())
+    {
+        if (thread_count > 1)
+            return parse_alignments_parallel<match_t>(mapped.view(), meta, dictionary, thread_count);
+
+        matches.reserve(estimate_line_count(mapped.view()));
+        parse_alignments(mapped.view(), matches, meta, dictionary, loaded.is_sorted);
+        return loaded;
+    }
+
+    // pipes and other streams that can not be mapped
+    std::array<std::string_view, 9> line_vec; // Stellar GFF format output has 9 columns
+    std::vector<char> buffer(1ULL << 20);
+    std::ifstream fin;
+    fin.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    fin.open(match_path, mode);
     std::string line;
     while (std::getline(fin, line))
     {
-        auto line_vec = get_line_vector<std::string>(line, '\t');
+        size_t const field_count = split_line(line, '\t', line_vec);
 
         //!WORKAROUND: for valik_search_segments test that writes output file names instead of matches
-        if (line_vec.size() == 1)
+        if (field_count == 1)
             break;
 
-        assert(line_vec.size() == 9); // Stellar GFF format output has 9 columns
-        match_t match(line_vec, meta);
-        matches.push_back(match);
+        if (!is_alignment_record<std::tuple_size_v<decltype(line_vec)>>(line, field_count))
+            continue;
+
+        matches.emplace_back(line_vec, meta, dictionary);
+        if (matches.size() > 1)
+            loaded.is_sorted &= !(matches.back() < matches[matches.size() - 2]);
     }
 
     fin.close();
 
-    return matches;
+    return loaded;
 }
 
 template <typename match_t>
+std::vector<match_t> read_alignment_output(std::filesystem::path const & match_path,
+                                           valik::custom::metadata const & meta,
+                                           match_dictionary & dictionary,
+                                           std::ios_base::openmode const mode = std::ios_base::in,
+                                           size_t const thread_count = 1)
+{
+    return load_alignments<match_t>(match_path, meta, dictionary, mode, thread_count).matches;
+}
+
+/**
+ * @brief Reads one alignment at a time, so that only the current line is kept in memory.
+ */
+template <typename match_t>
+class alignment_reader
+{
+public:
+    alignment_reader(std::filesystem::path const & match_path,
+                     valik::custom::metadata const & meta,
+                     match_dictionary & dictionary) : meta(meta), dictionary(dictionary)
+    {
+        fin.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+        fin.open(match_path);
+        if (!fin.is_open())
+            throw std::runtime_error{"Could not open " + match_path.string()};
+    }
+
+    alignment_reader(alignment_reader const &) = delete;
+    alignment_reader & operator=(alignment_reader const &) = delete;
+    ~alignment_reader() = default;
+
+    /**
+     * @brief Function that returns the next alignment or nothing at the end of the file.
+     */
+    std::optional<match_t> next()
+    {
+        size_t field_count{0};
+        do
+        {
+            if (!std::getline(fin, line))
+                return std::nullopt;
+
+            field_count = split_line(line, '\t', line_vec);
+
+            //!WORKAROUND: for valik_search_segments test that writes output file names instead of matches
+            if (field_count == 1)
+                return std::nullopt;
+        }
+        while (!is_alignment_record<std::tuple_size_v<decltype(line_vec)>>(line, field_count));
+
+        return std::optional<match_t>{std::in_place, line_vec, meta, dictionary};
+    }
+
+private:
+    valik::custom::metadata const & meta;
+    match_dictionary & dictionary;
+    std::vector<char> buffer = std::vector<char>(1ULL << 20);
+    std::ifstream fin{};
+    std::string line{};
+    std::array<std::string_view, 9> line_vec{}; // Stellar GFF format output has 9 columns
+};
+
+/**
+ * @brief Function that writes alignments to a file.
+ *
+ * @param matches   Any range of matches, e.g. a vector or a view that gathers matches by index.
+ */
+template <std::ranges::input_range matches_t>
 void write_alignment_output(std::filesystem::path const & out_path,
-                            std::vector<match_t> const & matches,
+                            matches_t && matches,
+                            valik::custom::metadata const & meta,
+                            match_dictionary const & dictionary,
                             bool append = false)
 {
     std::ofstream fout;
@@ -50,8 +338,11 @@ void write_alignment_output(std::filesystem::path const & out_path,
     else
         fout.open(out_path);
 
-    for (auto match : matches)
-        fout << match.to_string();
+    {
+        alignment_writer out(fout);
+        for (auto const & match : matches)
+            match.write(out, meta, dictionary);
+    }
 
     fout.close();
 }
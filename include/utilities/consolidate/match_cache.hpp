@@ -0,0 +1,366 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <accuracy/blast_match.hpp>
+#include <valik/split/metadata.hpp>
+#include <utilities/consolidate/stellar_match.hpp>
+#include <utilities/mapped_file.hpp>
+#include <utilities/match_dictionary.hpp>
+
+namespace valik
+{
+
+/**
+ * @brief Extension of sorted binary match sets that were converted from a GFF or BLAST tabular file.
+ */
+inline constexpr std::string_view match_cache_extension{".mcache"};
+
+/**
+ * @brief Fixed-size beginning of a match cache file.
+ *
+ * The file continues with the path of the reference metadata, one column per match field, the query names,
+ * the verbatim numbers and the output-only text of the matches. Every section starts at a multiple of 8 bytes.
+ * Numbers are stored in native byte order.
+ */
+struct match_cache_header
+{
+    enum class match_format : uint32_t
+    {
+        stellar_gff,
+        blast_tabular
+    };
+
+    std::array<char, 8> magic{};
+    uint32_t version{};
+    match_format format{};
+    uint64_t match_count{};
+    uint64_t meta_fingerprint{}; // metadata_fingerprint of the metadata the reference names were resolved with
+    uint64_t sequence_count{};
+    uint32_t column_count{};
+    uint32_t record_size{};      // sum of the column widths
+    uint64_t query_count{};
+    uint64_t verbatim_count{};
+    uint64_t text_size{};
+    uint64_t meta_path_length{};
+
+    static constexpr std::array<char, 8> expected_magic{'V', 'A', 'L', 'I', 'K', 'M', 'C', 'H'};
+    static constexpr uint32_t current_version{1};
+
+    template <typename match_t>
+    static constexpr match_format format_of()
+    {
+        return std::is_same_v<match_t, stellar_match> ? match_format::stellar_gff : match_format::blast_tabular;
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<match_cache_header> && sizeof(match_cache_header) == 80);
+
+/**
+ * @brief Function that hashes the reference sequences of the metadata, which determine the reference indices of
+ *        parsed matches.
+ */
+inline uint64_t metadata_fingerprint(custom::metadata const & meta)
+{
+    uint64_t hash{14695981039346656037ULL}; // FNV-1a
+    auto add = [&](std::string_view const bytes)
+    {
+        for (char const c : bytes)
+            hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+    };
+
+    for (auto const & seq : meta.sequences)
+    {
+        add(seq.id);
+        add(std::string_view{reinterpret_cast<char const *>(&seq.ind), sizeof(seq.ind)});
+        add(std::string_view{reinterpret_cast<char const *>(&seq.len), sizeof(seq.len)});
+    }
+    return hash;
+}
+
+inline bool is_match_cache(std::filesystem::path const & path)
+{
+    return path.extension() == match_cache_extension;
+}
+
+/**
+ * @brief Function that reads the header of a match cache and checks that it was written by this version.
+ */
+inline match_cache_header read_match_cache_header(std::filesystem::path const & path)
+{
+    match_cache_header header{};
+    std::ifstream in(path, std::ios::binary);
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        header.magic != match_cache_header::expected_magic)
+        throw std::runtime_error{path.string() + " is not a match cache."};
+
+    if (header.version != match_cache_header::current_version)
+        throw std::runtime_error{path.string() + " was written by a different version of the match cache format. "
+                                 "Convert the alignments again."};
+    return header;
+}
+
+/**
+ * @brief Function that returns whether an alignment file or match cache holds Stellar GFF records.
+ */
+inline bool is_stellar_input(std::filesystem::path const & path)
+{
+    if (is_match_cache(path))
+        return read_match_cache_header(path).format == match_cache_header::match_format::stellar_gff;
+
+    return path.extension() == ".gff";
+}
+
+/**
+ * @brief Function that returns the extension of the text format of an alignment file or match cache.
+ */
+inline std::string alignment_extension(std::filesystem::path const & path)
+{
+    if (is_match_cache(path))
+        return is_stellar_input(path) ? ".gff" : ".txt";
+
+    return path.extension().string();
+}
+
+namespace detail
+{
+
+template <typename match_t>
+std::vector<size_t> match_column_widths()
+{
+    std::vector<size_t> widths{};
+    auto blank = std::bit_cast<match_t>(std::array<std::byte, sizeof(match_t)>{});
+    match_t::columns(blank, [&](auto const & ... fields)
+    {
+        (widths.push_back(sizeof(fields)), ...);
+    });
+    return widths;
+}
+
+inline size_t padded_size(size_t const size)
+{
+    return (size + 7) / 8 * 8;
+}
+
+} // namespace detail
+
+/**
+ * @brief Function that writes matches column by column into a match cache.
+ *
+ * @param matches       Matches sorted by (ref_ind, dbegin, dend).
+ * @param meta_path     Path of the reference metadata, stored for error messages.
+ */
+template <typename match_t>
+void write_match_cache(std::filesystem::path const & out_path,
+                       std::vector<match_t> const & matches,
+                       custom::metadata const & meta,
+                       std::filesystem::path const & meta_path,
+                       match_dictionary const & dictionary)
+{
+    static constexpr bool has_text = requires (match_t match) { match.alignment_attributes; };
+
+    std::vector<size_t> const widths = detail::match_column_widths<match_t>();
+    std::vector<std::string> columns(widths.size());
+    for (size_t column{0}; column < widths.size(); column++)
+        columns[column].reserve(widths[column] * matches.size());
+
+    // the text is copied in match order, so that the spans of the cache are contiguous
+    std::string text{};
+    for (match_t record : matches)
+    {
+        if constexpr (has_text)
+        {
+            std::string_view const match_text = dictionary.text(record.alignment_attributes);
+            record.alignment_attributes = text_span{text.size(), static_cast<uint32_t>(match_text.size())};
+            text.append(match_text);
+        }
+
+        match_t::columns(record, [&](auto const & ... fields)
+        {
+            size_t column{0};
+            (columns[column++].append(reinterpret_cast<char const *>(&fields), sizeof(fields)), ...);
+        });
+    }
+
+    match_cache_header header{};
+    header.magic = match_cache_header::expected_magic;
+    header.version = match_cache_header::current_version;
+    header.format = match_cache_header::format_of<match_t>();
+    header.match_count = matches.size();
+    header.meta_fingerprint = metadata_fingerprint(meta);
+    header.sequence_count = meta.sequences.size();
+    header.column_count = widths.size();
+    header.record_size = std::accumulate(widths.begin(), widths.end(), size_t{0});
+    header.query_count = dictionary.query_count();
+    header.verbatim_count = dictionary.verbatim_number_count();
+    header.text_size = text.size();
+    header.meta_path_length = meta_path.string().size();
+
+    std::ofstream out(out_path, std::ios::binary);
+    if (!out.is_open())
+        throw std::runtime_error{"Could not open " + out_path.string()};
+
+    auto put = [&](void const * data, size_t const size)
+    {
+        static constexpr std::array<char, 8> padding{};
+        out.write(static_cast<char const *>(data), size);
+        out.write(padding.data(), detail::padded_size(size) - size);
+    };
+
+    auto put_strings = [&](size_t const count, auto const & string_at)
+    {
+        std::vector<uint64_t> offsets{0};
+        std::string strings{};
+        for (uint32_t id{0}; id < count; id++)
+        {
+            strings.append(string_at(id));
+            offsets.push_back(strings.size());
+        }
+        put(offsets.data(), offsets.size() * sizeof(uint64_t));
+        put(strings.data(), strings.size());
+    };
+
+    put(&header, sizeof(header));
+    put(meta_path.string().data(), header.meta_path_length);
+    for (auto const & column : columns)
+        put(column.data(), column.size());
+    put_strings(header.query_count, [&](uint32_t const id) { return dictionary.query_name(id); });
+    put_strings(header.verbatim_count, [&](uint32_t const id) { return dictionary.verbatim_number(id); });
+    put(text.data(), text.size());
+
+    if (!out)
+        throw std::runtime_error{"Could not write " + out_path.string()};
+}
+
+/**
+ * @brief Function that loads the sorted matches of a match cache.
+ *
+ * The query names, verbatim numbers and text are added to dictionary and the matches refer to them.
+ * The file is mapped, but not used in place: the text section is copied into the pool of dictionary and the columns
+ * are gathered into a vector of matches, which needs about as much memory as parsing the alignments.
+ * Ids, reference indices and text spans that point outside of the cache or the metadata are rejected.
+ *
+ * @param meta  Reference metadata, which has to be the one that the cache was converted with.
+ */
+template <typename match_t>
+std::vector<match_t> read_match_cache(std::filesystem::path const & cache_path,
+                                      custom::metadata const & meta,
+                                      match_dictionary & dictionary)
+{
+    match_cache_header const header = read_match_cache_header(cache_path);
+    if (header.format != match_cache_header::format_of<match_t>())
+        throw std::runtime_error{cache_path.string() + " holds matches of a different alignment format."};
+
+    mapped_file const mapped(cache_path);
+    std::string_view const file = mapped.view();
+    size_t cursor{0};
+    auto take = [&](size_t const size)
+    {
+        if (file.size() < cursor + size)
+            throw std::runtime_error{"Match cache " + cache_path.string() + " is truncated."};
+        std::string_view const section = file.substr(cursor, size);
+        cursor = std::min(file.size(), cursor + detail::padded_size(size));
+        return section;
+    };
+
+    take(sizeof(header));
+    std::string_view const meta_path = take(header.meta_path_length);
+    if (header.meta_fingerprint != metadata_fingerprint(meta))
+        throw std::runtime_error{cache_path.string() + " was converted with the reference metadata " +
+                                 std::string{meta_path} + ", which does not match --ref-meta."};
+
+    std::vector<size_t> const widths = detail::match_column_widths<match_t>();
+    if (header.column_count != widths.size() ||
+        header.record_size != std::accumulate(widths.begin(), widths.end(), size_t{0}))
+        throw std::runtime_error{cache_path.string() + " does not have the columns of this version. "
+                                 "Convert the alignments again."};
+
+    std::vector<char const *> columns{};
+    for (size_t const width : widths)
+        columns.push_back(take(width * header.match_count).data());
+
+    // ids of the cache are translated to the ids of dictionary like after parsing with a separate dictionary
+    id_translation translation{};
+    auto take_strings = [&](size_t const count, auto const & intern)
+    {
+        std::vector<uint64_t> offsets(count + 1);
+        std::memcpy(offsets.data(), take(offsets.size() * sizeof(uint64_t)).data(), offsets.size() * sizeof(uint64_t));
+        std::string_view const strings = take(offsets.back());
+        for (size_t id{0}; id < count; id++)
+            intern(strings.substr(offsets[id], offsets[id + 1] - offsets[id]));
+    };
+    take_strings(header.query_count, [&](std::string_view const name)
+    {
+        translation.query_ids.push_back(dictionary.query_id(name));
+    });
+    take_strings(header.verbatim_count, [&](std::string_view const number)
+    {
+        translation.verbatim_ids.push_back(dictionary.verbatim_number_id(number));
+    });
+    translation.text_offset = dictionary.store(take(header.text_size)).offset;
+
+    auto is_valid_format = [&](number_format const & format)
+    {
+        if (format.notation == number_format::style::verbatim)
+            return format.verbatim_id < header.verbatim_count;
+        return format.notation == number_format::style::fixed || format.notation == number_format::style::scientific;
+    };
+
+    auto is_valid = [&](match_t const & match)
+    {
+        if (match.qid >= header.query_count || !is_valid_format(match.percid_format))
+            return false;
+        if (meta.pos_by_ind.size() <= match.ref_ind || meta.pos_by_ind[match.ref_ind] == meta.sequences.size())
+            return false;
+        if constexpr (requires { match.evalue_format; })
+        {
+            if (!is_valid_format(match.evalue_format))
+                return false;
+        }
+        if constexpr (requires { match.alignment_attributes; })
+        {
+            text_span const & span = match.alignment_attributes;
+            if (span.offset > header.text_size || span.length > header.text_size - span.offset)
+                return false;
+        }
+        return true;
+    };
+
+    std::vector<match_t> matches{};
+    matches.reserve(header.match_count);
+    for (size_t i{0}; i < header.match_count; i++)
+    {
+        auto match = std::bit_cast<match_t>(std::array<std::byte, sizeof(match_t)>{});
+        match_t::columns(match, [&](auto & ... fields)
+        {
+            size_t column{0};
+            ((std::memcpy(&fields, columns[column++] + i * sizeof(fields), sizeof(fields))), ...);
+        });
+
+        if (!is_valid(match))
+            throw std::runtime_error{"Match cache " + cache_path.string() + " is corrupt."};
+
+        match.translate(translation);
+        matches.push_back(match);
+    }
+
+    return matches;
+}
+
+} // namespace valik
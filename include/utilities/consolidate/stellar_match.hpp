@@ -4,72 +4,86 @@
 
 #pragma once
 
+#include <array>
+#include <limits>
+#include <ranges>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+
+#include <utilities/alignment_writer.hpp>
+#include <utilities/match_dictionary.hpp>
 #include <utilities/shared.hpp>
 #include <valik/split/metadata.hpp>
 
 namespace valik
 {
 
+/**
+ * @brief A Stellar GFF record. The reference is kept as its index in the metadata, the query as its id in a
+ *        match_dictionary and the text that is only needed for output as spans into the dictionary.
+ *        Numbers are written back in the format they were read in.
+ */
 struct stellar_match
 {
-    std::string dname{};
     size_t ref_ind{};
     uint64_t dbegin{};
     uint64_t dend{};
-    std::string percid;
+    float percid{};
     bool is_forward_match{true};
-    std::string qname{};
+    uint32_t qid{};
     uint64_t qbegin{};
     uint64_t qend{};
-    std::string alignment_attributes{};
+    double evalue{std::numeric_limits<double>::quiet_NaN()}; // NaN if the record has no eValue attribute
+    number_format percid_format{};
+    text_span alignment_attributes{};
 
-    stellar_match(std::vector<std::string> const & match_vec, valik::custom::metadata const & meta)
+    template <std::ranges::random_access_range fields_t>
+        requires std::convertible_to<std::ranges::range_reference_t<fields_t const &>, std::string_view>
+    stellar_match(fields_t const & match_vec, valik::custom::metadata const & meta, match_dictionary & dictionary)
     {
-        dname = match_vec[0];
+        ref_ind = meta.ind_from_id(match_vec[0]);
 
-        ref_ind = meta.ind_from_id(dname);
+        dbegin = parse_number<uint64_t>(match_vec[3]);
+        dend = parse_number<uint64_t>(match_vec[4]);
 
-        dbegin = stoi(match_vec[3]);
-        dend = stoi(match_vec[4]);
+        percid = parse_number<float>(match_vec[5]);
+        percid_format = dictionary.format_of(match_vec[5], percid);
 
-        percid = match_vec[5];
-
-        if (match_vec[6] == "-")
+        if (std::string_view{match_vec[6]} == "-")
             is_forward_match = false;
 
         // Stellar GFF attributes
         // 1;seq2Range=1280,1378;cigar=97M1D2M;mutations=14A,45G,58T,92C
         // OR
-        // 1;seq2Range=1280,1378;eValue=4.05784e-73;cigar=97M1D2M;mutations=14A,45G,58T,92C        
-        std::vector<std::string> attributes_vec = get_line_vector<std::string>(match_vec[8], ';');
-    
-        if (attributes_vec.size() == 4 || attributes_vec.size() == 5)
+        // 1;seq2Range=1280,1378;eValue=4.05784e-73;cigar=97M1D2M;mutations=14A,45G,58T,92C
+        std::string_view const attributes{match_vec[8]};
+        std::array<std::string_view, 5> attributes_vec;
+        size_t const attribute_count = split_line(attributes, ';', attributes_vec);
+
+        if (attribute_count == 4 || attribute_count == 5)
         {
-            qname = attributes_vec[0];
-            qbegin = stoi(attributes_vec[1].substr(attributes_vec[1].find("=") + 1, 
-                                                   attributes_vec[1].find(",") - attributes_vec[1].find("=") - 1));
-            qend = stoi(attributes_vec[1].substr(attributes_vec[1].find(",") + 1));
+            qid = dictionary.query_id(attributes_vec[0]);
+            std::string_view const range = attributes_vec[1];
+            qbegin = parse_number<uint64_t>(range.substr(range.find("=") + 1, range.find(",") - range.find("=") - 1));
+            qend = parse_number<uint64_t>(range.substr(range.find(",") + 1));
 
-            for (auto it = attributes_vec.begin() + 2; it < attributes_vec.end() - 1; it++)
+            for (size_t i{2}; i < attribute_count; i++)
             {
-                alignment_attributes += *it;
-                alignment_attributes += ";";
+                if (attributes_vec[i].starts_with("eValue="))
+                    evalue = parse_number<double>(attributes_vec[i].substr(7));
             }
-            
-            alignment_attributes += attributes_vec[attributes_vec.size() - 1];
+
+            std::string_view const last_attribute = attributes_vec[attribute_count - 1];
+            alignment_attributes = dictionary.store(std::string_view{attributes_vec[2].begin(), last_attribute.end()});
         }
         else
         {
-            std::string attributes{};
-            for (auto & field : attributes_vec)
-            {
-                attributes += field;
-                attributes += ";";
-            }
-            if (attributes.size() > 0)
-                attributes.pop_back();
-        
-            throw std::runtime_error("Malformed GFF record:\n" + attributes);
+            std::string_view malformed{attributes};
+            if (malformed.ends_with(';'))
+                malformed.remove_suffix(1);
+
+            throw std::runtime_error("Malformed GFF record:\n" + std::string{malformed});
         }
     }
 
@@ -83,11 +97,11 @@ struct stellar_match
 
     bool operator == (stellar_match const & other) const
     {
-        if (dname == other.dname &&
+        if (ref_ind == other.ref_ind &&
             dbegin == other.dbegin &&
             dend == other.dend &&
             is_forward_match == other.is_forward_match &&
-            qname == other.qname &&
+            qid == other.qid &&
             qbegin == other.qbegin &&
             percid_is_equal_to(other.percid))
             return true;
@@ -129,59 +143,72 @@ struct stellar_match
         }
     }
 
-    std::string get_cigar() const
+    std::string get_cigar(match_dictionary const & dictionary) const
     {
-        std::vector<std::string> attributes_vec = get_line_vector<std::string>(alignment_attributes, ';');
+        std::vector<std::string> attributes_vec = get_line_vector<std::string>(std::string{dictionary.text(alignment_attributes)}, ';');
         return attributes_vec[attributes_vec.size() - 2];
     }
 
-    std::string get_mutations() const
+    std::string get_mutations(match_dictionary const & dictionary) const
     {
-        return alignment_attributes.substr(alignment_attributes.find("mutations="));
+        std::string_view const attributes = dictionary.text(alignment_attributes);
+        return std::string{attributes.substr(attributes.find("mutations="))};
     }
 
-    bool percid_is_equal_to(std::string const & other) const
+    bool percid_is_equal_to(float const other) const
     {
         float eps{0.001};
-        float this_percid = std::stof(percid);
-        float other_percid = std::stof(other);
+        return std::abs(percid - other) < eps;
+    }
 
-        return abs(this_percid - other_percid) < eps;
+    /**
+     * @brief Function that updates the ids and spans after the dictionary of the match was merged into another one.
+     */
+    void translate(id_translation const & translation)
+    {
+        translation.translate_query(qid);
+        translation.translate(percid_format);
+        translation.translate(alignment_attributes);
     }
 
-    std::string to_string() const
+    /**
+     * @brief Function that passes the fields of a match to archive, e.g. to store matches column by column.
+     */
+    template <typename match_t, typename archive_t>
+        requires std::same_as<std::remove_const_t<match_t>, stellar_match>
+    static void columns(match_t & match, archive_t && archive)
     {
-        std::string match_str = dname;
-        match_str += "\tStellar\teps-matches\t";
-        match_str += std::to_string(dbegin);
-        match_str += "\t";
-        match_str += std::to_string(dend);
-        match_str += "\t";
-        match_str += percid;
-
-        match_str += "\t";
-
-        if (is_forward_match)
-            match_str += "+";
-        else
-            match_str += "-";
+        archive(match.ref_ind, match.dbegin, match.dend, match.percid, match.is_forward_match, match.qid,
+                match.qbegin, match.qend, match.evalue, match.percid_format.notation, match.percid_format.precision,
+                match.percid_format.verbatim_id, match.alignment_attributes.offset, match.alignment_attributes.length);
+    }
+
+    /**
+     * @brief Function that formats the match as a GFF line.
+     */
+    void write(alignment_writer & out, valik::custom::metadata const & meta, match_dictionary const & dictionary) const
+    {
+        out << meta.id_from_ind(ref_ind) << "\tStellar\teps-matches\t" << dbegin << '\t' << dend << '\t';
+        out.write_number(percid, percid_format, dictionary);
+        out << (is_forward_match ? "\t+\t.\t" : "\t-\t.\t");
 
-        match_str += "\t.\t";
-        
         // 1;seq2Range=1280,1378;cigar=97M1D2M;mutations=14A,45G,58T,92C
-        match_str += qname;
-        match_str += ";";
-        match_str += "seq2Range=";
-        match_str += std::to_string(qbegin);
-        match_str += ",";
-        match_str += std::to_string(qend);
-        match_str += ";";
-        match_str += alignment_attributes;
-        match_str += "\n";
-
-        return match_str;
+        out << dictionary.query_name(qid) << ";seq2Range=" << qbegin << ',' << qend << ';'
+            << dictionary.text(alignment_attributes) << '\n';
+    }
+
+    std::string to_string(valik::custom::metadata const & meta, match_dictionary const & dictionary) const
+    {
+        std::ostringstream match_str;
+        {
+            alignment_writer out(match_str, 0);
+            write(out, meta, dictionary);
+        }
+        return match_str.str();
     }
 
 };
 
+static_assert(std::is_trivially_copyable_v<stellar_match>);
+
 }   // namespace valik
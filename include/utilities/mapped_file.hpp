@@ -0,0 +1,90 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace valik
+{
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * Only non-empty regular files are mapped. For anything else (pipes, process substitution, missing files)
+ * is_mapped() is false and the caller has to fall back to stream based reading.
+ */
+class mapped_file
+{
+public:
+    mapped_file() = default;
+    mapped_file(mapped_file const &) = delete;
+    mapped_file & operator=(mapped_file const &) = delete;
+
+    mapped_file(mapped_file && other) noexcept :
+        data{std::exchange(other.data, nullptr)}, length{std::exchange(other.length, 0)}
+    {}
+
+    mapped_file & operator=(mapped_file && other) noexcept
+    {
+        std::swap(data, other.data);
+        std::swap(length, other.length);
+        return *this;
+    }
+
+    ~mapped_file()
+    {
+        if (data != nullptr)
+            munmap(data, length);
+    }
+
+    /**
+     * @brief Constructor that maps the file and advises the kernel that it will be read sequentially.
+     *
+     * @param path Input file path.
+     */
+    explicit mapped_file(std::filesystem::path const & path)
+    {
+        int const fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat file_stats;
+        if (fstat(fd, &file_stats) == 0 && S_ISREG(file_stats.st_mode) && file_stats.st_size > 0)
+        {
+            void * mapped = mmap(nullptr, file_stats.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED)
+            {
+                data = static_cast<char *>(mapped);
+                length = file_stats.st_size;
+                madvise(data, length, MADV_SEQUENTIAL);
+            }
+        }
+
+        close(fd);
+    }
+
+    bool is_mapped() const
+    {
+        return data != nullptr;
+    }
+
+    std::string_view view() const
+    {
+        return std::string_view{data, length};
+    }
+
+private:
+    char * data{nullptr};
+    size_t length{0};
+};
+
+} // namespace valik
@@ -0,0 +1,315 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <valik/split/metadata.hpp>
+
+namespace valik
+{
+
+/**
+ * @brief Location of a piece of text in the text pool of a match_dictionary.
+ *
+ * \param offset    Position of the first character in the pool.
+ * \param length    Number of characters.
+ */
+struct text_span
+{
+    uint64_t offset{0};
+    uint32_t length{0};
+};
+
+/**
+ * @brief How a floating point field was written, so that the parsed value can be written back unchanged.
+ *
+ * \param notation     Fixed or scientific notation for std::to_chars, or verbatim if to_chars can not reproduce the
+ *                      field (e.g. an upper case exponent). Verbatim fields are interned in the match_dictionary.
+ * \param precision    Number of digits after the decimal point.
+ * \param verbatim_id  Id of the interned field text if notation is verbatim.
+ */
+struct number_format
+{
+    enum class style : uint8_t
+    {
+        fixed,
+        scientific,
+        verbatim
+    };
+
+    style notation{style::fixed};
+    uint8_t precision{0};
+    uint32_t verbatim_id{0};
+};
+
+/**
+ * @brief Maps the ids and text spans of one match_dictionary to those of another one it was merged into.
+ */
+struct id_translation
+{
+    std::vector<uint32_t> query_ids{};
+    std::vector<uint32_t> verbatim_ids{};
+    uint64_t text_offset{0};
+
+    void translate_query(uint32_t & query_id) const
+    {
+        query_id = query_ids[query_id];
+    }
+
+    void translate(number_format & format) const
+    {
+        if (format.notation == number_format::style::verbatim)
+            format.verbatim_id = verbatim_ids[format.verbatim_id];
+    }
+
+    void translate(text_span & span) const
+    {
+        span.offset += text_offset;
+    }
+};
+
+/**
+ * @brief Assigns consecutive 32-bit ids to distinct strings.
+ */
+class string_interner
+{
+public:
+    string_interner() = default;
+    string_interner(string_interner const &) = delete;
+    string_interner & operator=(string_interner const &) = delete;
+    string_interner(string_interner &&) = default;
+    string_interner & operator=(string_interner &&) = default;
+    ~string_interner() = default;
+
+    /**
+     * @brief Function that returns the id of a string and assigns the next free id to unseen strings.
+     */
+    uint32_t id(std::string_view const str)
+    {
+        auto it = ids.find(str);
+        if (it != ids.end())
+            return it->second;
+
+        if (strings.size() == std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error{"Too many distinct strings to intern."};
+
+        uint32_t const new_id = strings.size();
+        it = ids.emplace(std::string{str}, new_id).first;
+        strings.push_back(it->first);
+        return new_id;
+    }
+
+    std::string_view at(uint32_t const id) const
+    {
+        return strings[id];
+    }
+
+    size_t size() const
+    {
+        return strings.size();
+    }
+
+private:
+    // Keys are stable under rehashing, so strings can point to them.
+    std::unordered_map<std::string, uint32_t, custom::metadata::id_hash, std::equal_to<>> ids{};
+    std::vector<std::string_view> strings{};
+};
+
+/**
+ * @brief Interned query names and output-only text of parsed alignments.
+ *
+ * Match records keep numerical query ids and text spans into the dictionary instead of strings, so that they can
+ * be sorted and compared as fixed-size values. Truth and test matches have to be parsed with the same dictionary
+ * for their query ids to be comparable. The text is only needed again when matches are written out.
+ */
+class match_dictionary
+{
+public:
+    match_dictionary() = default;
+    match_dictionary(match_dictionary const &) = delete;
+    match_dictionary & operator=(match_dictionary const &) = delete;
+    match_dictionary(match_dictionary &&) = default;
+    match_dictionary & operator=(match_dictionary &&) = default;
+    ~match_dictionary() = default;
+
+    /**
+     * @brief Function that returns the id of a query name and assigns the next free id to unseen names.
+     *
+     * @param name Query sequence name.
+     */
+    uint32_t query_id(std::string_view const name)
+    {
+        return query_names.id(name);
+    }
+
+    std::string_view query_name(uint32_t const id) const
+    {
+        return query_names.at(id);
+    }
+
+    size_t query_count() const
+    {
+        return query_names.size();
+    }
+
+    /**
+     * @brief Function that copies text into the pool.
+     *
+     * @param text Text that is only needed for writing the match.
+     */
+    text_span store(std::string_view const text)
+    {
+        text_span span{pool_begin + pool.size(), static_cast<uint32_t>(text.size())};
+        pool.append(text);
+        return span;
+    }
+
+    std::string_view text(text_span const span) const
+    {
+        return std::string_view{pool}.substr(span.offset - pool_begin, span.length);
+    }
+
+    /**
+     * @brief Function that allows the pool to release text that was stored before offset.
+     *        Spans that begin before offset must not be used afterwards.
+     *
+     * @param offset Offset of the oldest span that is still in use.
+     */
+    void discard_text_before(uint64_t const offset)
+    {
+        if (offset <= pool_begin)
+            return;
+
+        // release in large steps, so that the remaining text is moved rarely
+        size_t const discarded = std::min<uint64_t>(offset - pool_begin, pool.size());
+        if (discarded < (1ULL << 20) || discarded < pool.size() / 2)
+            return;
+
+        pool.erase(0, discarded);
+        pool_begin += discarded;
+    }
+
+    /**
+     * @brief Function that finds the format that writes value back as field.
+     *
+     * @param field Text the value was parsed from.
+     * @param value Parsed value.
+     */
+    template <typename number_t>
+        requires std::is_floating_point_v<number_t>
+    number_format format_of(std::string_view const field, number_t const value)
+    {
+        number_format format{};
+        size_t const exponent = field.find('e');
+        if (exponent != std::string_view::npos)
+            format.notation = number_format::style::scientific;
+
+        std::string_view const mantissa = field.substr(0, exponent);
+        size_t const point = mantissa.find('.');
+        size_t const precision = (point == std::string_view::npos) ? 0 : mantissa.size() - point - 1;
+        if (precision <= std::numeric_limits<uint8_t>::max())
+        {
+            format.precision = precision;
+            std::array<char, max_number_length> buffer;
+            if (number_text(value, format, buffer) == field)
+                return format;
+        }
+
+        format.notation = number_format::style::verbatim;
+        format.verbatim_id = verbatim_numbers.id(field);
+        return format;
+    }
+
+    /**
+     * @brief Function that returns the text of a number as it was written in the input.
+     *
+     * @param value     Parsed value.
+     * @param format    Format returned by format_of.
+     * @param buffer    Storage for the formatted number. Empty if the buffer is too short.
+     */
+    template <typename number_t>
+        requires std::is_floating_point_v<number_t>
+    std::string_view number_text(number_t const value, number_format const format, std::span<char> buffer) const
+    {
+        if (format.notation == number_format::style::verbatim)
+            return verbatim_numbers.at(format.verbatim_id);
+
+        std::chars_format const notation = (format.notation == number_format::style::scientific)
+                                         ? std::chars_format::scientific
+                                         : std::chars_format::fixed;
+        auto [end, error] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value, notation, format.precision);
+        if (error != std::errc{})
+            return std::string_view{};
+
+        return std::string_view{buffer.data(), end};
+    }
+
+    /**
+     * @brief Function that returns the id of a number that is kept verbatim and assigns the next free id to unseen
+     *        numbers, e.g. when loading numbers that were interned by another dictionary.
+     */
+    uint32_t verbatim_number_id(std::string_view const field)
+    {
+        return verbatim_numbers.id(field);
+    }
+
+    std::string_view verbatim_number(uint32_t const id) const
+    {
+        return verbatim_numbers.at(id);
+    }
+
+    size_t verbatim_number_count() const
+    {
+        return verbatim_numbers.size();
+    }
+
+    /**
+     * @brief Function that adds the names, numbers and text of another dictionary to this one.
+     *        Unseen names are assigned ids in the order of the other dictionary, so merging the dictionaries of
+     *        consecutive parts of a file gives the same ids as parsing the whole file with one dictionary.
+     *
+     * @param other Dictionary that was used to parse some matches.
+     * @return Translation of the ids and spans of the parsed matches.
+     */
+    id_translation merge(match_dictionary const & other)
+    {
+        id_translation translation{};
+        translation.query_ids.reserve(other.query_count());
+        for (uint32_t id{0}; id < other.query_count(); id++)
+            translation.query_ids.push_back(query_id(other.query_name(id)));
+
+        translation.verbatim_ids.reserve(other.verbatim_numbers.size());
+        for (uint32_t id{0}; id < other.verbatim_numbers.size(); id++)
+            translation.verbatim_ids.push_back(verbatim_numbers.id(other.verbatim_numbers.at(id)));
+
+        translation.text_offset = pool_begin + pool.size() - other.pool_begin;
+        pool.append(other.pool);
+        return translation;
+    }
+
+    // Buffer size that fits every number that format_of does not keep verbatim.
+    static constexpr size_t max_number_length{128};
+
+private:
+    string_interner query_names{};
+    string_interner verbatim_numbers{};
+    std::string pool{};
+    uint64_t pool_begin{0}; // offset of the first character that is still in the pool
+};
+
+} // namespace valik
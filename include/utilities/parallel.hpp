@@ -0,0 +1,168 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace valik
+{
+
+/**
+ * @brief Function that calls task(i) for every i in [0, task_count) on up to thread_count threads.
+ *        Tasks are handed out in increasing order from a shared counter. The first exception thrown by a task is
+ *        rethrown after all threads have finished.
+ *
+ * @param task_count    Number of tasks.
+ * @param thread_count  Maximum number of threads, including the calling thread.
+ * @param task          Callable that takes the task index.
+ */
+template <typename task_t>
+void parallel_for(size_t const task_count, size_t const thread_count, task_t && task)
+{
+    std::atomic<size_t> next_task{0};
+    std::exception_ptr first_exception{};
+    std::mutex exception_mutex{};
+
+    auto worker = [&]()
+    {
+        for (size_t i = next_task++; i < task_count; i = next_task++)
+        {
+            try
+            {
+                task(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                if (!first_exception)
+                    first_exception = std::current_exception();
+                next_task = task_count;
+            }
+        }
+    };
+
+    size_t const helper_count = std::min(std::max<size_t>(thread_count, 1), task_count);
+    {
+        std::vector<std::jthread> helpers{};
+        for (size_t t{1}; t < helper_count; t++)
+            helpers.emplace_back(worker);
+        worker();
+    }
+
+    if (first_exception)
+        std::rethrow_exception(first_exception);
+}
+
+/**
+ * @brief Function that calls task(i) for every i in [0, task_count) on up to thread_count threads with work stealing.
+ *        Each thread starts on its own contiguous block of tasks, so that neighbouring tasks stay on one thread.
+ *        A thread that runs out of tasks steals from the back of the block with the most remaining tasks.
+ *        The first exception thrown by a task is rethrown after all threads have finished.
+ *
+ * @param task_count    Number of tasks.
+ * @param thread_count  Maximum number of threads, including the calling thread.
+ * @param task          Callable that takes the task index.
+ */
+template <typename task_t>
+void work_stealing_for(size_t const task_count, size_t const thread_count, task_t && task)
+{
+    struct task_block
+    {
+        std::mutex mutex{};
+        size_t begin{};
+        size_t end{};
+
+        size_t remaining()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return end - begin;
+        }
+    };
+
+    size_t const worker_count = std::min(std::max<size_t>(thread_count, 1), std::max<size_t>(task_count, 1));
+    std::vector<task_block> blocks(worker_count);
+    for (size_t w{0}; w < worker_count; w++)
+    {
+        blocks[w].begin = task_count * w / worker_count;
+        blocks[w].end = task_count * (w + 1) / worker_count;
+    }
+
+    std::atomic<bool> cancelled{false};
+    std::exception_ptr first_exception{};
+    std::mutex exception_mutex{};
+
+    auto next_task = [&](size_t const w, size_t & i)
+    {
+        {
+            std::lock_guard<std::mutex> lock(blocks[w].mutex);
+            if (blocks[w].begin < blocks[w].end)
+            {
+                i = blocks[w].begin++;
+                return true;
+            }
+        }
+
+        while (true)
+        {
+            size_t victim{w};
+            size_t most_remaining{0};
+            for (size_t v{0}; v < worker_count; v++)
+            {
+                size_t const remaining = blocks[v].remaining();
+                if (remaining > most_remaining)
+                {
+                    victim = v;
+                    most_remaining = remaining;
+                }
+            }
+
+            if (most_remaining == 0)
+                return false;
+
+            std::lock_guard<std::mutex> lock(blocks[victim].mutex);
+            if (blocks[victim].begin < blocks[victim].end)
+            {
+                i = --blocks[victim].end;
+                return true;
+            }
+        }
+    };
+
+    auto worker = [&](size_t const w)
+    {
+        size_t i{};
+        while (!cancelled && next_task(w, i))
+        {
+            try
+            {
+                task(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                if (!first_exception)
+                    first_exception = std::current_exception();
+                cancelled = true;
+            }
+        }
+    };
+
+    {
+        std::vector<std::jthread> helpers{};
+        for (size_t w{1}; w < worker_count; w++)
+            helpers.emplace_back(worker, w);
+        worker(0);
+    }
+
+    if (first_exception)
+        std::rethrow_exception(first_exception);
+}
+
+} // namespace valik
@@ -0,0 +1,160 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <utilities/parallel.hpp>
+
+namespace valik
+{
+
+/**
+ * @brief A (ref_ind, dbegin, dend) sort key packed into 128 bits and the index of the match it belongs to.
+ */
+struct packed_match_key
+{
+    uint64_t high{0};
+    uint64_t low{0};
+    size_t index{0};
+
+    /**
+     * @brief Function that appends the lowest bit_count bits of value to the key.
+     */
+    void append(uint64_t const value, int const bit_count)
+    {
+        if (bit_count == 0)
+            return;
+
+        if (bit_count == 64)
+        {
+            high = low;
+            low = value;
+            return;
+        }
+
+        high = (high << bit_count) | (low >> (64 - bit_count));
+        low = (low << bit_count) | value;
+    }
+
+    uint8_t digit(size_t const byte) const
+    {
+        return (byte < 8) ? (low >> (8 * byte)) : (high >> (8 * (byte - 8)));
+    }
+};
+
+/**
+ * @brief Function that sorts matches by (ref_ind, dbegin, dend) like std::less, but stable.
+ *
+ * The three fields are packed into a 128-bit key with the width of their largest value. The keys are sorted with a
+ * least significant digit radix sort on bytes, which skips bytes that are the same for all keys. Each pass counts and
+ * scatters the keys in up to thread_count blocks. The matches are then permuted once. Falls back to std::stable_sort
+ * if the fields do not fit into 128 bits.
+ *
+ * @param matches       Matches to sort.
+ * @param thread_count  Maximum number of threads, including the calling thread.
+ */
+template <typename match_t>
+void sort_matches(std::vector<match_t> & matches, size_t const thread_count = 1)
+{
+    size_t const match_count = matches.size();
+    if (match_count < 2)
+        return;
+
+    uint64_t max_ref_ind{0};
+    uint64_t max_dbegin{0};
+    uint64_t max_dend{0};
+    for (auto const & match : matches)
+    {
+        max_ref_ind = std::max<uint64_t>(max_ref_ind, match.ref_ind);
+        max_dbegin = std::max<uint64_t>(max_dbegin, match.dbegin);
+        max_dend = std::max<uint64_t>(max_dend, match.dend);
+    }
+
+    int const ref_ind_bits = std::bit_width(max_ref_ind);
+    int const dbegin_bits = std::bit_width(max_dbegin);
+    int const dend_bits = std::bit_width(max_dend);
+    if (ref_ind_bits + dbegin_bits + dend_bits > 128)
+    {
+        std::stable_sort(matches.begin(), matches.end(), std::less<match_t>());
+        return;
+    }
+
+    // blocks of consecutive keys are counted and scattered by one thread each
+    size_t const block_count = std::clamp<size_t>(match_count >> 16, 1, std::max<size_t>(thread_count, 1));
+    auto block_begin = [&](size_t const block) { return match_count * block / block_count; };
+
+    std::vector<packed_match_key> keys(match_count);
+    parallel_for(block_count, thread_count, [&](size_t const block)
+    {
+        for (size_t i = block_begin(block); i < block_begin(block + 1); i++)
+        {
+            packed_match_key & key = keys[i];
+            key.append(matches[i].ref_ind, ref_ind_bits);
+            key.append(matches[i].dbegin, dbegin_bits);
+            key.append(matches[i].dend, dend_bits);
+            key.index = i;
+        }
+    });
+
+    std::vector<packed_match_key> scattered_keys(match_count);
+    std::vector<std::array<size_t, 256>> block_offsets(block_count);
+    size_t const byte_count = (ref_ind_bits + dbegin_bits + dend_bits + 7) / 8;
+    for (size_t byte{0}; byte < byte_count; byte++)
+    {
+        parallel_for(block_count, thread_count, [&](size_t const block)
+        {
+            block_offsets[block].fill(0);
+            for (size_t i = block_begin(block); i < block_begin(block + 1); i++)
+                block_offsets[block][keys[i].digit(byte)]++;
+        });
+
+        // skip bytes that do not change the order
+        bool is_constant{false};
+        for (size_t digit{0}; digit < 256; digit++)
+        {
+            size_t digit_count{0};
+            for (auto const & counts : block_offsets)
+                digit_count += counts[digit];
+            is_constant |= (digit_count == match_count);
+        }
+        if (is_constant)
+            continue;
+
+        size_t offset{0};
+        for (size_t digit{0}; digit < 256; digit++)
+        {
+            for (auto & counts : block_offsets)
+            {
+                size_t const count = counts[digit];
+                counts[digit] = offset;
+                offset += count;
+            }
+        }
+
+        parallel_for(block_count, thread_count, [&](size_t const block)
+        {
+            auto & offsets = block_offsets[block];
+            for (size_t i = block_begin(block); i < block_begin(block + 1); i++)
+                scattered_keys[offsets[keys[i].digit(byte)]++] = keys[i];
+        });
+        keys.swap(scattered_keys);
+    }
+
+    std::vector<match_t> sorted_matches(matches);
+    parallel_for(block_count, thread_count, [&](size_t const block)
+    {
+        for (size_t i = block_begin(block); i < block_begin(block + 1); i++)
+            sorted_matches[i] = matches[keys[i].index];
+    });
+    matches.swap(sorted_matches);
+}
+
+} // namespace valik
@@ -0,0 +1,238 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace valik
+{
+
+namespace detail
+{
+
+// Counters of the operator new that is linked into the evaluate executable. Other binaries keep them at 0.
+inline std::atomic<bool> is_counting_allocations{false};
+inline std::atomic<uint64_t> allocation_count{0};
+inline std::atomic<uint64_t> allocated_bytes{0};
+
+inline void count_allocation(std::size_t const size)
+{
+    if (is_counting_allocations.load(std::memory_order_relaxed))
+    {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief Function that starts counting allocations, which costs two atomic increments per allocation.
+ */
+inline void start_counting_allocations()
+{
+    detail::is_counting_allocations.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Function that returns the number of allocations with operator new since counting started.
+ */
+inline uint64_t allocation_count()
+{
+    return detail::allocation_count.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Function that returns the number of bytes allocated with operator new since counting started.
+ */
+inline uint64_t allocated_bytes()
+{
+    return detail::allocated_bytes.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Snapshot of the resources that the process has used so far.
+ */
+struct resource_usage
+{
+    std::chrono::steady_clock::time_point wall{};
+    double cpu_seconds{};      // user and system time of all threads
+    uint64_t peak_rss_bytes{}; // high-water mark of the resident set size
+    uint64_t allocations{};
+    uint64_t allocated_bytes{};
+
+    static resource_usage now()
+    {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        auto seconds = [](timeval const & time) { return time.tv_sec + time.tv_usec / 1e6; };
+        return resource_usage{std::chrono::steady_clock::now(),
+                              seconds(usage.ru_utime) + seconds(usage.ru_stime),
+                              static_cast<uint64_t>(usage.ru_maxrss) * 1024, // kilobytes on Linux
+                              allocation_count(),
+                              valik::allocated_bytes()};
+    }
+};
+
+/**
+ * @brief Time, throughput and memory of the phases of a run, written as JSON with --stats-json.
+ *
+ * Phases can be recorded from several threads. CPU time and allocations are counted for the whole process, so phases
+ * that run at the same time, e.g. the truth and test parse, share them. Allocations are only counted in the evaluate
+ * executable after start_counting_allocations.
+ */
+class run_statistics
+{
+public:
+    struct phase
+    {
+        std::string name{};
+        std::string input{};   // file the phase read or wrote, if any
+        double wall_seconds{};
+        double cpu_seconds{};
+        uint64_t records{};
+        uint64_t bytes{};
+        uint64_t allocations{};
+        uint64_t allocated_bytes{};
+        uint64_t peak_rss_bytes{}; // high-water mark at the end of the phase
+    };
+
+    run_statistics() : start(resource_usage::now())
+    {}
+
+    /**
+     * @brief Function that records a phase that started at begin.
+     */
+    void add(std::string name,
+             std::string input,
+             resource_usage const & begin,
+             uint64_t const records,
+             uint64_t const bytes)
+    {
+        resource_usage const end = resource_usage::now();
+        std::lock_guard lock{phases_mutex};
+        phases.push_back(phase{std::move(name),
+                               std::move(input),
+                               std::chrono::duration<double>(end.wall - begin.wall).count(),
+                               end.cpu_seconds - begin.cpu_seconds,
+                               records,
+                               bytes,
+                               end.allocations - begin.allocations,
+                               end.allocated_bytes - begin.allocated_bytes,
+                               end.peak_rss_bytes});
+    }
+
+    /**
+     * @brief Function that writes the phases in the order they finished and the totals of the run.
+     */
+    void write_json(std::filesystem::path const & path) const
+    {
+        resource_usage const end = resource_usage::now();
+        std::ofstream out(path);
+        if (!out.is_open())
+            throw std::runtime_error{"Could not open " + path.string()};
+
+        auto per_second = [](uint64_t const count, double const seconds) { return (seconds > 0) ? count / seconds : 0.0; };
+
+        out << "{\n";
+        out << "  \"wall_seconds\": " << std::chrono::duration<double>(end.wall - start.wall).count() << ",\n";
+        out << "  \"cpu_seconds\": " << end.cpu_seconds << ",\n";
+        out << "  \"peak_rss_bytes\": " << end.peak_rss_bytes << ",\n";
+        out << "  \"allocations\": " << end.allocations << ",\n";
+        out << "  \"allocated_bytes\": " << end.allocated_bytes << ",\n";
+        out << "  \"phases\": [";
+        std::lock_guard lock{phases_mutex};
+        for (size_t i{0}; i < phases.size(); i++)
+        {
+            phase const & p = phases[i];
+            out << (i == 0 ? "\n" : ",\n");
+            out << "    {\"name\": " << quoted(p.name) << ", \"input\": " << quoted(p.input)
+                << ", \"wall_seconds\": " << p.wall_seconds << ", \"cpu_seconds\": " << p.cpu_seconds
+                << ", \"records\": " << p.records << ", \"bytes\": " << p.bytes
+                << ", \"records_per_second\": " << per_second(p.records, p.wall_seconds)
+                << ", \"bytes_per_second\": " << per_second(p.bytes, p.wall_seconds)
+                << ", \"allocations\": " << p.allocations << ", \"allocated_bytes\": " << p.allocated_bytes
+                << ", \"peak_rss_bytes\": " << p.peak_rss_bytes << "}";
+        }
+        out << "\n  ]\n}\n";
+
+        if (!out)
+            throw std::runtime_error{"Could not write " + path.string()};
+    }
+
+private:
+    resource_usage const start;
+    mutable std::mutex phases_mutex{};
+    std::vector<phase> phases{};
+
+    static std::string quoted(std::string_view const text)
+    {
+        std::string json{"\""};
+        for (char const c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                json += '\\';
+                json += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[7];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                json += escaped;
+            }
+            else
+            {
+                json += c;
+            }
+        }
+        return json + '"';
+    }
+};
+
+/**
+ * @brief Measures one phase of a run if statistics are collected and does nothing otherwise.
+ */
+class phase_timer
+{
+public:
+    phase_timer(run_statistics * const statistics, std::string name, std::string input = {}) :
+        statistics(statistics), name(std::move(name)), input(std::move(input))
+    {
+        if (statistics)
+            begin = resource_usage::now();
+    }
+
+    /**
+     * @brief Function that ends the phase after it processed records records that take up bytes bytes.
+     */
+    void stop(uint64_t const records, uint64_t const bytes)
+    {
+        if (statistics)
+            statistics->add(std::move(name), std::move(input), begin, records, bytes);
+        statistics = nullptr;
+    }
+
+private:
+    run_statistics * statistics;
+    std::string name;
+    std::string input;
+    resource_usage begin{};
+};
+
+} // namespace valik
@@ -4,10 +4,17 @@
 
 #pragma once
 
+#include <charconv>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <system_error>
+#include <type_traits>
+#include <string_view>
 #include <vector>
 
 #include <seqan3/core/debug_stream.hpp>
@@ -28,4 +35,68 @@ std::vector<field_t> get_line_vector(std::string const & line, char const delim)
     return line_vec;
 }
 
+/**
+ * @brief Function that splits a line into fields without copying them.
+ *        Like std::getline, an empty field after a trailing delimiter is dropped.
+ *
+ * @param line      Line to split.
+ * @param delim     Field delimiter.
+ * @param fields    Views into line for the first fields.size() fields.
+ * @return Number of fields in the line, which can be larger than fields.size().
+ */
+inline size_t split_line(std::string_view const line, char const delim, std::span<std::string_view> fields)
+{
+    size_t field_count{0};
+    size_t field_begin{0};
+    while (field_begin < line.size())
+    {
+        size_t field_end = line.find(delim, field_begin);
+        if (field_end == std::string_view::npos)
+            field_end = line.size();
+
+        if (field_count < fields.size())
+            fields[field_count] = line.substr(field_begin, field_end - field_begin);
+        field_count++;
+        field_begin = field_end + 1;
+    }
+
+    return field_count;
+}
+
+/**
+ * @brief Function that parses a whole field as a number without going through the locale.
+ *        Surrounding whitespace is ignored, any other trailing characters are an error.
+ *
+ * @param field Text of the field.
+ * @return The parsed value.
+ */
+template <typename number_t>
+    requires std::is_arithmetic_v<number_t>
+number_t parse_number(std::string_view field)
+{
+    constexpr std::string_view whitespace{" \t\r\n"};
+    size_t const first = field.find_first_not_of(whitespace);
+    field = (first == std::string_view::npos) ? std::string_view{} : field.substr(first, field.find_last_not_of(whitespace) - first + 1);
+
+    number_t value{};
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    if constexpr (std::is_floating_point_v<number_t>)
+    {
+        // from_chars leaves the value untouched on under- and overflow, strtod returns 0 or infinity
+        if (error == std::errc::result_out_of_range)
+        {
+            std::string const copy{field};
+            char * copy_end{};
+            value = std::strtod(copy.c_str(), &copy_end);
+            end = field.data() + (copy_end - copy.c_str());
+            error = std::errc{};
+        }
+    }
+
+    if (error != std::errc{} || end != field.data() + field.size() || field.empty())
+        throw std::runtime_error{"Can not parse number from field '" + std::string{field} + "'."};
+
+    return value;
+}
+
 } // namespace valik
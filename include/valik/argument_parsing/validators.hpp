@@ -46,6 +46,13 @@ public:
             throw sharg::validation_error{"The value must be a positive integer."};
     }
 
+    template <std::ranges::forward_range range_type>
+        requires std::convertible_to<std::ranges::range_value_t<range_type>, option_value_type>
+    void operator()(range_type const & values) const
+    {
+        std::ranges::for_each(values, [&](auto const & val) { (*this)(val); });
+    }
+
     std::string get_help_page_message () const
     {
         if (is_zero_positive)
@@ -13,6 +13,8 @@
 #include <fstream>
 #include <ranges>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
 
 #include <cereal/archives/binary.hpp> 
 #include <cereal/types/vector.hpp>
@@ -163,6 +165,18 @@ struct metadata
         }
     };
 
+    /** !\brief Hash for looking up sequences by std::string or std::string_view without a temporary copy.
+     */
+    struct id_hash
+    {
+        using is_transparent = void;
+
+        size_t operator() (std::string_view const id) const noexcept
+        {
+            return std::hash<std::string_view>{}(id);
+        }
+    };
+
     uint64_t total_len{0};
     size_t seq_count;
     size_t seg_count;
@@ -173,6 +187,15 @@ struct metadata
     std::vector<sequence_stats> sequences;
     std::vector<segment_stats> segments;
 
+    // Fasta ID -> sequence_stats::ind and sequence_stats::ind -> position in sequences, rebuilt on every load.
+    std::unordered_map<std::string, size_t, id_hash, std::equal_to<>> ind_by_id;
+    std::vector<size_t> pos_by_ind;
+
+        /**
+         * @brief Constructor of an empty metadata struct that is filled in and saved, e.g. for synthetic data.
+         */
+        metadata() = default;
+
         /**
          * @brief Constructor that deserializes a metadata struct from file.
          */
@@ -186,13 +209,44 @@ struct metadata
          *
          * @param string_id Fasta ID.
          */
-        inline size_t ind_from_id(std::string const & string_id) const
+        inline size_t ind_from_id(std::string_view const string_id) const
         {
-            auto it = std::find_if(sequences.begin(), sequences.end(), [&](const sequence_stats& seq) { return seq.id == string_id;});
-            if (it == sequences.end())
-                throw seqan3::validation_error{"Sequence metadata does not contain sequence " + string_id + " from alignment output."};
+            auto it = ind_by_id.find(string_id);
+            if (it == ind_by_id.end())
+                throw seqan3::validation_error{"Sequence metadata does not contain sequence " + std::string{string_id} + " from alignment output."};
             else
-                return (*it).ind;
+                return it->second;
+        }
+
+        /**
+         * @brief Function that returns the fasta ID of a sequence based on its numerical index.
+         *
+         * @param ind Index of sequence.
+         */
+        inline std::string const & id_from_ind(size_t const ind) const
+        {
+            if (pos_by_ind.size() <= ind || pos_by_ind[ind] == sequences.size())
+                throw std::runtime_error{"Sequence " + std::to_string(ind) + " index out of range."};
+
+            return sequences[pos_by_ind[ind]].id;
+        }
+
+        /**
+         * @brief Function that returns the numerical indices of a batch of fasta IDs.
+         *
+         * @param string_ids Range of fasta IDs.
+         */
+        template <std::ranges::input_range ids_t>
+        std::vector<size_t> inds_from_ids(ids_t && string_ids) const
+        {
+            std::vector<size_t> inds;
+            if constexpr (std::ranges::sized_range<ids_t>)
+                inds.reserve(std::ranges::size(string_ids));
+
+            for (auto const & string_id : string_ids)
+                inds.push_back(ind_from_id(string_id));
+
+            return inds;
         }
 
         /**
@@ -249,6 +303,19 @@ struct metadata
             archive(total_len, pattern_size, files, sequences, segments, ibf_fpr);
             seq_count = sequences.size();
             seg_count = segments.size();
+
+            ind_by_id.clear();
+            ind_by_id.reserve(sequences.size());
+            pos_by_ind.assign(sequences.size(), sequences.size());
+            for (size_t pos{0}; pos < sequences.size(); pos++)
+            {
+                sequence_stats const & seq = sequences[pos];
+                ind_by_id.emplace(seq.id, seq.ind);
+                if (pos_by_ind.size() <= seq.ind)
+                    pos_by_ind.resize(seq.ind + 1, sequences.size());
+                if (pos_by_ind[seq.ind] == sequences.size())
+                    pos_by_ind[seq.ind] = pos;
+            }
         }
 
         std::string to_string()
@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#include <cstdlib>
+#include <new>
+
+#include <utilities/run_statistics.hpp>
+
+// The evaluate executable replaces the global operator new to count allocations for --stats-json. Allocations are
+// only counted after valik::start_counting_allocations. The array and nothrow forms of the standard library forward to
+// the two forms below, and the replaced operator delete frees memory of both.
+
+namespace
+{
+
+template <typename allocate_t>
+void * allocate_or_throw(std::size_t const size, allocate_t && allocate)
+{
+    valik::detail::count_allocation(size);
+    while (true)
+    {
+        if (void * const memory = allocate())
+            return memory;
+
+        std::new_handler const handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc{};
+        handler();
+    }
+}
+
+} // namespace
+
+void * operator new(std::size_t const size)
+{
+    return allocate_or_throw(size, [size]() { return std::malloc(size == 0 ? 1 : size); });
+}
+
+void * operator new(std::size_t const size, std::align_val_t const alignment)
+{
+    // aligned_alloc requires a size that is a multiple of the alignment
+    std::size_t const align = static_cast<std::size_t>(alignment);
+    std::size_t const padded_size = (size == 0) ? align : (size + align - 1) / align * align;
+    return allocate_or_throw(size, [=]() { return std::aligned_alloc(align, padded_size); });
+}
+
+void operator delete(void * const memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void * const memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void * const memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void * const memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
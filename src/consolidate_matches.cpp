@@ -19,58 +19,69 @@ std::string truncate_fasta_id(std::string const & id)
     return id.substr(0, first_whitespace);
 }
 
-void consolidate_matches(std::vector<stellar_match> & matches, accuracy_arguments const & arguments)
+void consolidate_matches(std::vector<stellar_match> & matches,
+                         match_dictionary const & dictionary,
+                         accuracy_arguments const & arguments)
 {
-    //auto before_duplicate_removal = matches.size();
-    std::sort(matches.begin(), matches.end(), std::greater<stellar_match>());
+    // group matches by query with a counting sort over the dense query ids
+    std::vector<size_t> group_offsets(dictionary.query_count() + 1, 0);
+    for (auto const & match : matches)
+        group_offsets[match.qid + 1]++;
+    std::partial_sum(group_offsets.begin(), group_offsets.end(), group_offsets.begin());
 
-    //seqan3::debug_stream << before_duplicate_removal << '\t' << matches.size() << '\n';
-    // <query_ind, <refs>>
-    std::unordered_set<std::string> overabundant_queries{}; 
-    std::unordered_set<std::string> disabled_queries{};
-    
-    // <query_ind, match_count>>
-    std::unordered_map<std::string, size_t> total_match_counter{};
-    
-    std::remove_reference_t<decltype(matches)> consolidated_matches{};
-    
-    for (auto & match : matches)
+    std::vector<size_t> grouped_matches(matches.size());
     {
-        if ( total_match_counter[match.qname] < arguments.disableThresh )
-        {
-            total_match_counter[match.qname]++;
-        }
+        std::vector<size_t> next_slot(group_offsets.begin(), group_offsets.end() - 1);
+        for (size_t i{0}; i < matches.size(); i++)
+            grouped_matches[next_slot[matches[i].qid]++] = i;
     }
-    
-    // for <query, ref> pairs that do not appear often return all matches
-    for (auto & match : matches)
+
+    // longer matches come later; among equally long matches the one that is further left in the reference or
+    // earlier in the input wins
+    auto keep_order = [&](size_t const left_ind, size_t const right_ind)
     {
-        bool is_disabled = total_match_counter[match.qname] >= arguments.disableThresh;
-        bool is_overabundant = total_match_counter[match.qname] > arguments.numMatches;
-         
-        if (!is_overabundant && !is_disabled)
-            consolidated_matches.emplace_back(match);
-        else if (is_disabled)
-            disabled_queries.emplace(match.qname);
-        else
-            overabundant_queries.emplace(match.qname);
-    }
+        auto const & left = matches[left_ind];
+        auto const & right = matches[right_ind];
+        if (stellar_match::length_order()(left, right))
+            return true;
+        if (stellar_match::length_order()(right, left))
+            return false;
+        if (std::greater<stellar_match>()(left, right))
+            return true;
+        if (std::greater<stellar_match>()(right, left))
+            return false;
+        return left_ind > right_ind;
+    };
 
-    // for <query, ref> pairs that appear often return arguments.numMatches longest matches
-    for (auto & query_id : overabundant_queries)
+    std::vector<uint32_t> overabundant_queries{};
+    size_t disabled_query_count{0};
+    std::vector<uint8_t> is_kept(matches.size(), 0);
+
+    for (uint32_t query_id{0}; query_id < dictionary.query_count(); query_id++)
     {
-        std::vector<stellar_match> overabundant_matches{};
-        auto is_query_match = [&](auto & m){
-                                                return (m.qname == query_id);
-                                            };
+        auto group_begin = grouped_matches.begin() + group_offsets[query_id];
+        auto group_end = grouped_matches.begin() + group_offsets[query_id + 1];
+        size_t const match_count = group_end - group_begin;
+
+        if (match_count == 0)
+            continue;
 
-        for (auto & m : matches | std::views::filter(is_query_match))
+        if (match_count >= arguments.disableThresh)
         {
-            overabundant_matches.push_back(m);
+            disabled_query_count++;
+            continue;
         }
 
-        std::sort(overabundant_matches.begin(), overabundant_matches.end(), stellar_match::length_order()); // sort in order of increasing length
-        consolidated_matches.insert(consolidated_matches.end(), overabundant_matches.end() - arguments.numMatches, overabundant_matches.end());    
+        // for queries that appear often return arguments.numMatches longest matches
+        if (match_count > arguments.numMatches)
+        {
+            overabundant_queries.push_back(query_id);
+            group_begin = group_end - arguments.numMatches;
+            std::nth_element(grouped_matches.begin() + group_offsets[query_id], group_begin, group_end, keep_order);
+        }
+
+        for (auto match_ind_it = group_begin; match_ind_it != group_end; match_ind_it++)
+            is_kept[*match_ind_it] = 1;
     }
 
     // debug
@@ -79,18 +90,24 @@ void consolidate_matches(std::vector<stellar_match> & matches, accuracy_argument
         seqan3::debug_stream << "Overabundant queries\n";
         for (auto & query_id : overabundant_queries)
         {
-            seqan3::debug_stream << query_id << '\n'; 
+            seqan3::debug_stream << dictionary.query_name(query_id) << '\n'; 
         }
     }
     
     // debug
     if (arguments.verbose)
-        seqan3::debug_stream << "Disabled " << disabled_queries.size() << " queries.\n";
+        seqan3::debug_stream << "Disabled " << disabled_query_count << " queries.\n";
     
-    matches = consolidated_matches;
-    std::sort(matches.begin(), matches.end(), std::less<stellar_match>()); 
+    // the kept matches stay in input order, so sorted input does not have to be sorted again
+    size_t kept_count{0};
+    for (size_t i{0}; i < matches.size(); i++)
+    {
+        if (is_kept[i])
+            matches[kept_count++] = matches[i];
+    }
+    matches.erase(matches.begin() + kept_count, matches.end());
 }
 
-void consolidate_matches(std::vector<blast_match> &, accuracy_arguments const &) { }
+void consolidate_matches(std::vector<blast_match> &, match_dictionary const &, accuracy_arguments const &) { }
 
 }  // namespace valik::custom
@@ -0,0 +1,26 @@
+// SPDX-FileCopyrightText: 2006-2024 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#include <accuracy/convert_matches.hpp>
+#include <accuracy/search_accuracy.hpp>
+
+// ./evaluate convert --input ../test/data/truth.gff --ref-meta ../test/data/meta.bin
+void convert_matches(convert_arguments const & arguments)
+{
+    valik::custom::metadata meta(arguments.ref_meta);
+    valik::match_dictionary dictionary{};
+
+    auto convert = [&]<typename match_t>()
+    {
+        auto matches = get_sorted_alignments<match_t>(arguments.input_file, meta, dictionary, arguments.threads);
+        valik::write_match_cache(arguments.out, matches, meta, arguments.ref_meta, dictionary);
+        if (arguments.verbose)
+            seqan3::debug_stream << "Converted matches\t" << matches.size() << '\n';
+    };
+
+    if (valik::is_stellar_input(arguments.input_file))
+        convert.template operator()<valik::stellar_match>();
+    else
+        convert.template operator()<blast_match>();
+}
@@ -2,17 +2,105 @@
 // SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: CC0-1.0
 
+#include <algorithm>
+#include <cctype>
+#include <set>
+#include <stdexcept>
+#include <string_view>
+
 #include <sharg/all.hpp>
 
 #include <valik/argument_parsing/validators.hpp>
 
+#include <accuracy/convert_matches.hpp>
 #include <accuracy/search_accuracy.hpp>
 #include <missed_match_profile.hpp>
 
+/**
+ * @brief Function that converts a size like 512m or 16G into bytes.
+ */
+size_t size_in_bytes(std::string const & size)
+{
+    size_t const multiplier = [&]() -> size_t
+    {
+        switch (std::tolower(size.back()))
+        {
+            case 't': return 1ULL << 40;
+            case 'g': return 1ULL << 30;
+            case 'm': return 1ULL << 20;
+            default: return 1ULL << 10;
+        }
+    }();
+    return std::stoull(size.substr(0, size.size() - 1)) * multiplier;
+}
+
+/**
+ * @brief Function that parses the arguments of the convert subcommand and converts the alignments.
+ */
+int convert_main(int argc, char ** argv)
+{
+    convert_arguments arguments{};
+    sharg::parser parser{"Alignment-Evaluator-convert", argc, argv};
+    parser.info.author = "Evelin Aasna";
+    parser.info.version = "1.0.0";
+    parser.info.short_description = "Convert alignments into a sorted binary match cache that --truth and --test accept.";
+
+    parser.add_option(arguments.input_file,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "input",
+                                    .description = "The alignments to convert.",
+                                    .required = true,
+                                    .validator = sharg::input_file_validator{{"gff", "txt"}}});
+    parser.add_option(arguments.ref_meta,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "ref-meta",
+                                    .description = "The reference metadata from valik split.",
+                                    .required = true,
+                                    .validator = sharg::input_file_validator{{}}});
+    parser.add_option(arguments.out,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "out",
+                                    .description = "Output match cache. Defaults to the input with the extension .mcache.",
+                                    .validator = sharg::output_file_validator{}});
+    parser.add_option(arguments.threads,
+                      sharg::config{.short_id = 't',
+                                    .long_id = "threads",
+                                    .description = "Choose the number of threads.",
+                                    .validator = valik::app::positive_integer_validator{false}});
+    parser.add_flag(arguments.verbose,
+                    sharg::config{.short_id = 'v',
+                                  .long_id = "verbose",
+                                  .description = "Give more detailed information."});
+
+    try
+    {
+        parser.parse();
+    }
+    catch (sharg::parser_error const & ext)
+    {
+        std::cerr << "Parsing error. " << ext.what() << '\n';
+        return -1;
+    }
+
+    if (!parser.is_option_set("out"))
+    {
+        arguments.out = arguments.input_file;
+        arguments.out.replace_extension(valik::match_cache_extension);
+    }
+
+    convert_matches(arguments);
+
+    return 0;
+}
+
 int main(int argc, char ** argv)
 {
+    if (argc > 1 && std::string_view{argv[1]} == "convert")
+        return convert_main(argc - 1, argv + 1);
+
     // Configuration
     accuracy_arguments arguments{};
+    std::string memory_limit{};
 
     // Parser
     sharg::parser parser{"Alignment-Evaluator", argc, argv};
@@ -24,15 +112,17 @@ int main(int argc, char ** argv)
     parser.add_option(arguments.truth_file,
                       sharg::config{.short_id = '\0',
                                     .long_id = "truth",
-                                    .description = "The ground truth.",
+                                    .description = "The ground truth. A match cache from the convert subcommand is "
+                                                   "loaded without parsing.",
                                     .required = true,
-                                    .validator = sharg::input_file_validator{{"gff", "txt"}}});
-    parser.add_option(arguments.test_file,
+                                    .validator = sharg::input_file_validator{{"gff", "txt", "mcache"}}});
+    parser.add_option(arguments.test_files,
                       sharg::config{.short_id = '\0',
                                     .long_id = "test",
-                                    .description = "The alignments to evaluate.",
+                                    .description = "The alignments to evaluate. Repeat the option to evaluate several "
+                                                   "files against the same truth.",
                                     .required = true,
-                                    .validator = sharg::input_file_validator{{"gff", "txt"}}});
+                                    .validator = sharg::input_file_validator{{"gff", "txt", "mcache"}}});
     parser.add_option(arguments.ref_meta,
                       sharg::config{.short_id = '\0',
                                     .long_id = "ref-meta",
@@ -44,10 +134,11 @@ int main(int argc, char ** argv)
                                     .long_id = "min-len",
                                     .description = "The minimum length of an epsilon match.",
                                     .validator = valik::app::positive_integer_validator{true}});
-    parser.add_option(arguments.min_overlap,
+    parser.add_option(arguments.min_overlaps,
                       sharg::config{.short_id = 'o',
                                     .long_id = "overlap",
-                                    .description = "The minimum length of an epsilon match.",
+                                    .description = "The minimum overlap of a test match with a true match. Repeat the "
+                                                   "option to evaluate several thresholds in one pass.",
                                     .validator = valik::app::positive_integer_validator{true}});
     parser.add_option(arguments.error_rate,
                       sharg::config{.short_id = 'e',
@@ -62,7 +153,28 @@ int main(int argc, char ** argv)
     parser.add_option(arguments.out,
                       sharg::config{.short_id = '\0',
                                     .long_id = "out",
-                                    .description = "Output prefix.",
+                                    .description = "Output prefix. With several test files, the name of each test file "
+                                                   "is appended to it.",
+                                    .validator = sharg::output_file_validator{}});
+    parser.add_option(arguments.threads,
+                      sharg::config{.short_id = 't',
+                                    .long_id = "threads",
+                                    .description = "Choose the number of threads.",
+                                    .validator = valik::app::positive_integer_validator{false}});
+    parser.add_option(memory_limit,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "memory-limit",
+                                    .description = "Sort inputs on disk using about this much memory per input, e.g. 4g. "
+                                                   "Implies streaming evaluation.",
+                                    .validator = valik::app::size_validator{"\\d+\\s{0,1}[k,m,g,t,K,M,G,T]"}});
+    parser.add_flag(arguments.streaming,
+                    sharg::config{.short_id = '\0',
+                                  .long_id = "streaming",
+                                  .description = "Evaluate inputs that are sorted by reference and position without loading them."});
+    parser.add_option(arguments.stats_json,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "stats-json",
+                                    .description = "Write the time, throughput and memory of each phase to this JSON file.",
                                     .validator = sharg::output_file_validator{}});
     parser.add_flag(arguments.verbose,
                     sharg::config{.short_id = 'v',
@@ -79,16 +191,56 @@ int main(int argc, char ** argv)
         return -1;
     }
 
-    if (arguments.min_overlap > arguments.min_len)
-        throw seqan3::argument_parser_error("Minimum overlap " + std::to_string(arguments.min_overlap) + " can not be larger than the minimum length " + std::to_string(arguments.min_len));
+    std::ranges::sort(arguments.min_overlaps);
+    arguments.min_overlaps.erase(std::unique(arguments.min_overlaps.begin(), arguments.min_overlaps.end()),
+                                 arguments.min_overlaps.end());
+    if (arguments.min_overlaps.back() > arguments.min_len)
+        throw seqan3::argument_parser_error("Minimum overlap " + std::to_string(arguments.min_overlaps.back()) + " can not be larger than the minimum length " + std::to_string(arguments.min_len));
 
-    if (!parser.is_option_set("out"))
+    if (parser.is_option_set("memory-limit"))
+        arguments.memory_limit = size_in_bytes(memory_limit);
+
+    if ((arguments.streaming || arguments.memory_limit > 0) && arguments.numMatches > 0)
+        throw seqan3::argument_parser_error("Matches can not be consolidated with --numMatches in --streaming mode "
+                                            "or with --memory-limit.");
+
+    if ((arguments.streaming || arguments.memory_limit > 0) && arguments.min_overlaps.size() > 1)
+        throw seqan3::argument_parser_error("Several overlap thresholds can not be evaluated in --streaming mode "
+                                            "or with --memory-limit.");
+
+    if ((arguments.streaming || arguments.memory_limit > 0) &&
+        (valik::is_match_cache(arguments.truth_file) || std::ranges::any_of(arguments.test_files, valik::is_match_cache)))
+        throw seqan3::argument_parser_error("Match caches are sorted and loaded directly. They can not be evaluated "
+                                            "with --streaming or --memory-limit.");
+
+    if (arguments.test_files.size() > 1)
+    {
+        std::set<std::filesystem::path> test_prefixes{};
+        for (auto const & test_file : arguments.test_files)
+        {
+            std::filesystem::path const prefix = parser.is_option_set("out") ? test_file.stem()
+                                                                             : test_file.parent_path() / test_file.stem();
+            if (!test_prefixes.insert(prefix).second)
+                throw seqan3::argument_parser_error("Several test files are named " + test_file.stem().string() +
+                                                    ". Their outputs would overwrite each other.");
+        }
+    }
+
+    if (!parser.is_option_set("out") && arguments.test_files.size() == 1)
     {
-        arguments.out = arguments.test_file;
+        arguments.out = arguments.test_files[0];
         arguments.out.replace_extension("");
     }
 
-    search_accuracy(arguments);
+    try
+    {
+        search_accuracy(arguments);
+    }
+    catch (std::runtime_error const & ext) // e.g. unsorted alignments in --streaming mode
+    {
+        std::cerr << "[Error] " << ext.what() << '\n';
+        return -1;
+    }
 
     return 0;
 }
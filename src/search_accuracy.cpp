@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: CC0-1.0
 
 #include <accuracy/search_accuracy.hpp>
+#include <utilities/parallel.hpp>
 
 template <typename func_t>
 void runtime_to_compile_time(func_t const & func, bool b1)
@@ -25,53 +26,387 @@ void runtime_to_compile_time(func_t const & func, bool b1, bs_t... bs)
     }, bs...);
 }
 
-// ./evaluate --truth ../test/data/truth.gff --test ../test/data/test.gff --ref-meta ../test/data/meta.bin
-void search_accuracy(accuracy_arguments const & arguments)
+/*! \brief Accuracy of one test file at one overlap threshold.
+ */
+struct test_report
 {
-    valik::custom::metadata meta(arguments.ref_meta);    
-    runtime_to_compile_time([&]<bool truth_is_gff, bool test_is_gff>()
+    std::filesystem::path test_file{};
+    size_t overlap{0};
+    size_t test_match_count{0};
+    uint64_t true_positive_count{0};
+    size_t false_positive_count{0};
+    size_t false_negative_count{0};
+};
+
+/*! \brief Function that prints the accuracy of a single evaluation, or one row per test file and overlap threshold
+ *         if there are several.
+ */
+void print_accuracy_report(std::vector<test_report> const & reports)
+{
+    seqan3::debug_stream << "Accuracy report\n"; 
+    if (reports.size() == 1)
     {
-        using truth_match_t = std::conditional_t<truth_is_gff, valik::stellar_match, blast_match>;
-        auto truth = get_sorted_alignments<truth_match_t>(arguments.truth_file, meta);
-        if (arguments.verbose)
-            seqan3::debug_stream << "Truth matches\t" << truth.size() << '\n';
+        seqan3::debug_stream << "True positives\t" << reports[0].true_positive_count << '\n';
+        seqan3::debug_stream << "False positives\t" << reports[0].false_positive_count << '\n';
+        seqan3::debug_stream << "False negatives\t" << reports[0].false_negative_count << '\n';
+        return;
+    }
+
+    seqan3::debug_stream << "Test\tOverlap\tTest matches\tTrue positives\tFalse positives\tFalse negatives\n";
+    for (auto const & report : reports)
+    {
+        seqan3::debug_stream << report.test_file.string() << '\t' << report.overlap << '\t'
+                             << report.test_match_count << '\t' << report.true_positive_count << '\t' << report.false_positive_count << '\t'
+                             << report.false_negative_count << '\n';
+    }
+}
+
+/*! \brief Function that returns the path of the false negatives or false positives of a test file.
+ *  \details A single test file writes to the --out prefix. Several test files write to the --out prefix followed by
+ *           the name of the test file, or next to the test file if there is no --out prefix. With several overlap
+ *           thresholds, the threshold is appended as well, e.g. prefix_o50.fn.gff.
+ */
+std::filesystem::path false_match_path(accuracy_arguments const & arguments,
+                                       size_t const test_ind,
+                                       size_t const overlap,
+                                       std::string const & kind,
+                                       std::filesystem::path const & input)
+{
+    std::string const suffix = kind + valik::alignment_extension(input);
+    if (arguments.test_files.size() == 1 && arguments.min_overlaps.size() == 1)
+    {
+        std::filesystem::path out = arguments.out;
+        out.replace_extension(suffix);
+        return out;
+    }
+
+    std::filesystem::path const & test_file = arguments.test_files[test_ind];
+    std::string prefix = arguments.out.string();
+    if (arguments.test_files.size() > 1)
+    {
+        prefix = arguments.out.empty() ? (test_file.parent_path() / test_file.stem()).string()
+                                       : arguments.out.string() + "_" + test_file.stem().string();
+    }
+    if (arguments.min_overlaps.size() > 1)
+        prefix += "_o" + std::to_string(overlap);
+
+    return prefix + "." + suffix;
+}
+
+/*! \brief Function that writes the false negatives and false positives of a test file for each overlap threshold.
+ *  \param results One result per threshold of arguments.min_overlaps.
+ */
+template <typename truth_match_t, typename test_match_t>
+std::vector<test_report> write_false_matches(accuracy_arguments const & arguments,
+                                             valik::custom::metadata const & meta,
+                                             size_t const test_ind,
+                                             std::vector<truth_match_t> const & truth,
+                                             valik::match_dictionary const & truth_dictionary,
+                                             std::vector<test_match_t> const & test,
+                                             valik::match_dictionary const & test_dictionary,
+                                             size_t const test_loaded_count,
+                                             std::vector<accuracy_result> const & results,
+                                             valik::run_statistics * const statistics)
+{
+    std::filesystem::path const & test_file = arguments.test_files[test_ind];
+    valik::phase_timer timer(statistics, "write", test_file.string());
+    uint64_t written_count{0};
+    uint64_t written_bytes{0};
+    std::vector<test_report> reports{};
+    for (size_t t{0}; t < results.size(); t++)
+    {
+        size_t const overlap = arguments.min_overlaps[t];
+        accuracy_result const & result = results[t];
+        std::filesystem::path const false_negative_out = false_match_path(arguments, test_ind, overlap, "fn",
+                                                                          arguments.truth_file);
+        std::filesystem::path const false_positive_out = false_match_path(arguments, test_ind, overlap, "fp",
+                                                                          test_file);
+        valik::write_alignment_output(false_negative_out, gather_matches(truth, result.false_negatives), meta,
+                                      truth_dictionary);
+        valik::write_alignment_output(false_positive_out, gather_matches(test, result.false_positives), meta,
+                                      test_dictionary);
+        reports.push_back(test_report{test_file, overlap, test_loaded_count, result.true_positive_count,
+                                      result.false_positives.size(), result.false_negatives.size()});
+
+        written_count += result.false_negatives.size() + result.false_positives.size();
+        if (statistics)
+            written_bytes += std::filesystem::file_size(false_negative_out) + std::filesystem::file_size(false_positive_out);
+    }
+    timer.stop(written_count, written_bytes);
+    return reports;
+}
+
+/*! \brief Function that keeps the arguments.numMatches longest matches per query, if it is set and the matches are
+ *         Stellar matches.
+ */
+template <typename match_t>
+void consolidate(std::vector<match_t> & matches,
+                 valik::match_dictionary const & dictionary,
+                 accuracy_arguments const & arguments,
+                 valik::run_statistics * const statistics,
+                 std::string const & role)
+{
+    if ((arguments.numMatches > 0) && (std::is_same<match_t, valik::stellar_match>()))
+    {
+        valik::phase_timer timer(statistics, role + " consolidation");
+        size_t const match_count = matches.size();
+        valik::custom::consolidate_matches(matches, dictionary, arguments);
+        timer.stop(match_count, match_count * sizeof(match_t));
+    }
+}
+
+/*! \brief Function that runs evaluate_accuracy as the overlap phase.
+ */
+template <typename truth_match_t, typename test_match_t>
+std::vector<accuracy_result> timed_evaluate_accuracy(std::vector<truth_match_t> const & truth,
+                                                     std::vector<test_match_t> const & test,
+                                                     std::filesystem::path const & test_file,
+                                                     accuracy_arguments const & arguments,
+                                                     size_t const thread_count,
+                                                     valik::run_statistics * const statistics)
+{
+    valik::phase_timer timer(statistics, "overlap", test_file.string());
+    auto results = evaluate_accuracy(truth, test, arguments.min_overlaps, thread_count);
+    timer.stop(truth.size() + test.size(), truth.size() * sizeof(truth_match_t) + test.size() * sizeof(test_match_t));
+    return results;
+}
+
+/*! \brief Function that evaluates alignments that are read in sorted order without loading them.
+ *  \details False negatives and false positives are written as soon as they can not overlap any later match.
+ */
+template <typename truth_reader_t, typename test_reader_t>
+test_report streaming_search_accuracy(accuracy_arguments const & arguments,
+                                      valik::custom::metadata const & meta,
+                                      valik::match_dictionary & dictionary,
+                                      truth_reader_t & truth_reader,
+                                      test_reader_t & test_reader,
+                                      std::filesystem::path const & false_negative_out,
+                                      std::filesystem::path const & false_positive_out)
+{
+    using truth_match_t = typename decltype(truth_reader.next())::value_type;
+    using test_match_t = typename decltype(test_reader.next())::value_type;
+    std::ofstream false_negative_fout(false_negative_out);
+    std::ofstream false_positive_fout(false_positive_out);
+    valik::alignment_writer false_negative_writer(false_negative_fout);
+    valik::alignment_writer false_positive_writer(false_positive_fout);
 
-        if ((arguments.numMatches > 0) && (std::is_same<truth_match_t, valik::stellar_match>()))
+    test_report report{};
+    report.overlap = arguments.min_overlaps.front();
+    stream_overlapping_matches(truth_reader, test_reader, report.overlap, dictionary,
+                               [&](truth_match_t const & true_match, bool const found)
+    {
+        if (!found)
         {
-            valik::custom::consolidate_matches(truth, arguments);
-            if (arguments.verbose)
-                seqan3::debug_stream << "Truth matches after consolidation\t" << truth.size() << '\n';
-            std::sort(truth.begin(), truth.end(), std::less<truth_match_t>()); 
+            true_match.write(false_negative_writer, meta, dictionary);
+            report.false_negative_count++;
         }
+    },
+                               [&](test_match_t const & test_match, bool const found)
+    {
+        report.test_match_count++;
+        if (found)
+        {
+            report.true_positive_count++;
+        }
+        else
+        {
+            test_match.write(false_positive_writer, meta, dictionary);
+            report.false_positive_count++;
+        }
+    });
 
-        using test_match_t = std::conditional_t<test_is_gff, valik::stellar_match, blast_match>;
-        auto test = get_sorted_alignments<test_match_t>(arguments.test_file, meta);
-        seqan3::debug_stream << "Test matches\t" << test.size() << '\n';
+    return report;
+}
+
+/*! \brief Function that evaluates each test file against a truth that is loaded once.
+ *  \details The test files are evaluated in parallel. Each of them is parsed with a dictionary that starts out
+ *           with the query names of the truth, so that the truth and its dictionary are only read.
+ */
+template <typename truth_match_t>
+std::vector<test_report> evaluate_test_files(accuracy_arguments const & arguments,
+                                             valik::custom::metadata const & meta,
+                                             std::vector<truth_match_t> const & truth,
+                                             valik::match_dictionary const & dictionary,
+                                             valik::run_statistics * const statistics)
+{
+    size_t const test_count = arguments.test_files.size();
+    size_t const parallel_test_count = std::min(test_count, arguments.threads);
+    size_t const test_threads = std::max<size_t>(arguments.threads / parallel_test_count, 1);
+
+    std::vector<std::vector<test_report>> reports(test_count);
+    valik::parallel_for(test_count, parallel_test_count, [&](size_t const test_ind)
+    {
+        std::filesystem::path const & test_file = arguments.test_files[test_ind];
+        runtime_to_compile_time([&]<bool test_is_gff>()
+        {
+            using test_match_t = std::conditional_t<test_is_gff, valik::stellar_match, blast_match>;
+            valik::match_dictionary test_dictionary{};
+            for (uint32_t query_id{0}; query_id < dictionary.query_count(); query_id++)
+                test_dictionary.query_id(dictionary.query_name(query_id));
+
+            auto test = get_sorted_alignments<test_match_t>(test_file, meta, test_dictionary, test_threads, statistics,
+                                                            "test");
+            size_t const test_loaded_count = test.size();
+            consolidate(test, test_dictionary, arguments, statistics, "test");
 
-        if ((arguments.numMatches > 0) && (std::is_same<test_match_t, valik::stellar_match>()))
+            auto const results = timed_evaluate_accuracy(truth, test, test_file, arguments, test_threads, statistics);
+            reports[test_ind] = write_false_matches(arguments, meta, test_ind, truth, dictionary, test, test_dictionary,
+                                                    test_loaded_count, results, statistics);
+        }, valik::is_stellar_input(test_file));
+    });
+
+    std::vector<test_report> all_reports{};
+    for (auto const & test_reports : reports)
+        all_reports.insert(all_reports.end(), test_reports.begin(), test_reports.end());
+    return all_reports;
+}
+
+/*! \brief Function that evaluates the test files and records its phases in statistics, if it is not null.
+ */
+void evaluate(accuracy_arguments const & arguments, valik::run_statistics * const statistics)
+{
+    valik::phase_timer meta_timer(statistics, "metadata load", arguments.ref_meta.string());
+    valik::custom::metadata meta(arguments.ref_meta);
+    meta_timer.stop(meta.sequences.size(), std::filesystem::file_size(arguments.ref_meta));
+
+    if (arguments.streaming || arguments.memory_limit > 0)
+    {
+        // the truth is read again for each test file
+        std::vector<test_report> reports{};
+        for (size_t test_ind{0}; test_ind < arguments.test_files.size(); test_ind++)
         {
-            valik::custom::consolidate_matches(test, arguments);
+            std::filesystem::path const & test_file = arguments.test_files[test_ind];
+            size_t const overlap = arguments.min_overlaps.front();
+            std::filesystem::path const false_negative_out = false_match_path(arguments, test_ind, overlap, "fn",
+                                                                              arguments.truth_file);
+            std::filesystem::path const false_positive_out = false_match_path(arguments, test_ind, overlap, "fp",
+                                                                              test_file);
+            valik::match_dictionary dictionary{};
+            runtime_to_compile_time([&]<bool truth_is_gff, bool test_is_gff>()
+            {
+                using truth_match_t = std::conditional_t<truth_is_gff, valik::stellar_match, blast_match>;
+                using test_match_t = std::conditional_t<test_is_gff, valik::stellar_match, blast_match>;
+                // parsing, the overlap search and writing are interleaved and measured as one phase
+                auto stream = [&](auto & truth_reader, auto & test_reader)
+                {
+                    valik::phase_timer timer(statistics, "streaming evaluation", test_file.string());
+                    reports.push_back(streaming_search_accuracy(arguments, meta, dictionary, truth_reader, test_reader,
+                                                                false_negative_out, false_positive_out));
+                    timer.stop(reports.back().test_match_count,
+                               std::filesystem::file_size(arguments.truth_file) + std::filesystem::file_size(test_file));
+                };
+
+                if (arguments.memory_limit > 0)
+                {
+                    // both inputs are sorted one after the other, so each of them may use the whole limit
+                    valik::phase_timer truth_timer(statistics, "truth sort", arguments.truth_file.string());
+                    valik::sorted_alignment_reader<truth_match_t> truth_reader(arguments.truth_file, meta, dictionary,
+                                                                               arguments.memory_limit);
+                    truth_timer.stop(truth_reader.match_count(), std::filesystem::file_size(arguments.truth_file));
+                    valik::phase_timer test_timer(statistics, "test sort", test_file.string());
+                    valik::sorted_alignment_reader<test_match_t> test_reader(test_file, meta, dictionary,
+                                                                             arguments.memory_limit);
+                    test_timer.stop(test_reader.match_count(), std::filesystem::file_size(test_file));
+                    if (arguments.verbose)
+                        seqan3::debug_stream << "Sorted runs\t" << truth_reader.run_count() << '\t' << test_reader.run_count() << '\n';
+                    stream(truth_reader, test_reader);
+                }
+                else
+                {
+                    valik::alignment_reader<truth_match_t> truth_reader(arguments.truth_file, meta, dictionary);
+                    valik::alignment_reader<test_match_t> test_reader(test_file, meta, dictionary);
+                    stream(truth_reader, test_reader);
+                }
+                reports.back().test_file = test_file;
+            }, valik::is_stellar_input(arguments.truth_file), valik::is_stellar_input(test_file));
+        }
+
+        print_accuracy_report(reports);
+        return;
+    }
+
+    valik::match_dictionary dictionary{};
+    if (arguments.test_files.size() > 1)
+    {
+        runtime_to_compile_time([&]<bool truth_is_gff>()
+        {
+            using truth_match_t = std::conditional_t<truth_is_gff, valik::stellar_match, blast_match>;
+            auto truth = get_sorted_alignments<truth_match_t>(arguments.truth_file, meta, dictionary, arguments.threads,
+                                                              statistics, "truth");
             if (arguments.verbose)
-                seqan3::debug_stream << "Test matches after consolidation\t" << test.size() << '\n';
+                seqan3::debug_stream << "Truth matches\t" << truth.size() << '\n';
+            if ((arguments.numMatches > 0) && (std::is_same<truth_match_t, valik::stellar_match>()))
+            {
+                consolidate(truth, dictionary, arguments, statistics, "truth");
+                if (arguments.verbose)
+                    seqan3::debug_stream << "Truth matches after consolidation\t" << truth.size() << '\n';
+            }
+
+            print_accuracy_report(evaluate_test_files(arguments, meta, truth, dictionary, statistics));
+        }, valik::is_stellar_input(arguments.truth_file));
+        return;
+    }
+
+    std::filesystem::path const & test_file = arguments.test_files[0];
+    runtime_to_compile_time([&]<bool truth_is_gff, bool test_is_gff>()
+    {
+        using truth_match_t = std::conditional_t<truth_is_gff, valik::stellar_match, blast_match>;
+        using test_match_t = std::conditional_t<test_is_gff, valik::stellar_match, blast_match>;
+
+        // Truth and test are loaded concurrently and share the thread budget. The test matches are parsed with
+        // their own dictionary, which is merged afterwards to give the same ids as loading one after the other.
+        size_t const truth_threads = std::max<size_t>(arguments.threads / 2, 1);
+        size_t const test_threads = std::max<size_t>(arguments.threads - truth_threads, 1);
+        valik::match_dictionary test_dictionary{};
+        std::vector<truth_match_t> truth;
+        std::vector<test_match_t> test;
+        size_t truth_loaded_count{0};
+        size_t test_loaded_count{0};
+        valik::parallel_for(2, arguments.threads, [&](size_t const task)
+        {
+            if (task == 0)
+            {
+                truth = get_sorted_alignments<truth_match_t>(arguments.truth_file, meta, dictionary, truth_threads,
+                                                             statistics, "truth");
+                truth_loaded_count = truth.size();
+                consolidate(truth, dictionary, arguments, statistics, "truth");
+            }
+            else
+            {
+                test = get_sorted_alignments<test_match_t>(test_file, meta, test_dictionary, test_threads, statistics,
+                                                           "test");
+                test_loaded_count = test.size();
+                consolidate(test, test_dictionary, arguments, statistics, "test");
+            }
+        });
+
+        valik::id_translation const test_translation = dictionary.merge(test_dictionary);
+        for (auto & match : test)
+            match.translate(test_translation);
+
+        if (arguments.verbose)
+        {
+            seqan3::debug_stream << "Truth matches\t" << truth_loaded_count << '\n';
+            if ((arguments.numMatches > 0) && (std::is_same<truth_match_t, valik::stellar_match>()))
+                seqan3::debug_stream << "Truth matches after consolidation\t" << truth.size() << '\n';
         }
 
+        seqan3::debug_stream << "Test matches\t" << test_loaded_count << '\n';
+        if (arguments.verbose && (arguments.numMatches > 0) && (std::is_same<test_match_t, valik::stellar_match>()))
+            seqan3::debug_stream << "Test matches after consolidation\t" << test.size() << '\n';
+
         if (arguments.verbose)
             seqan3::debug_stream << "dname\tfirst-bin\tlast-bin\ttrue-match-count\ttest-match-count\n";
-        auto sequences = meta.sequences;
-        std::sort(sequences.begin(), sequences.end(), valik::custom::metadata::fasta_order());
-            
-        auto truth_ref_begin = truth.begin();
-        auto test_ref_begin = test.begin();
-        std::vector<uint8_t> test_found_matches(test.size(), 0);
-
-        uint64_t true_positive_count{0};
-        std::vector<truth_match_t> false_negatives;
-        std::vector<test_match_t> false_positives;
-        for (auto & seq : sequences)
+        if (arguments.verbose)
         {
-            std::string const & current_ref_id = seq.id;
-            if (arguments.verbose)
+            auto sequences = meta.sequences;
+            std::sort(sequences.begin(), sequences.end(), valik::custom::metadata::fasta_order());
+
+            auto truth_ref_begin = truth.begin();
+            auto test_ref_begin = test.begin();
+            for (auto & seq : sequences)
             {
+                std::string const & current_ref_id = seq.id;
                 seqan3::debug_stream << current_ref_id << '\t';
 
                 valik::custom::metadata::segment_stats last_seg;  
@@ -87,61 +422,37 @@ void search_accuracy(accuracy_arguments const & arguments)
                     last_seg = seg; 
                 }
                 seqan3::debug_stream << last_seg.id << '\t';
-            }
-            auto is_next_ref = [&](auto match) { return match.dname != current_ref_id ;};
-            auto truth_ref_end = std::find_if(truth_ref_begin, truth.end(), is_next_ref);
-            auto test_ref_end = std::find_if(test_ref_begin, test.end(), is_next_ref);
-                
-            if (arguments.verbose)
-                seqan3::debug_stream << truth_ref_end - truth_ref_begin << '\t' << test_ref_end - test_ref_begin << '\n';
 
-            for (auto true_match_it = truth_ref_begin; true_match_it != truth_ref_end; true_match_it++)
-            {
-                auto const & true_match = *true_match_it;
-                bool only_in_truth_set{true};
-                for (auto test_match_it = test_ref_begin; test_match_it != test_ref_end; test_match_it++)
-                {
-                    auto const & test_match = *test_match_it;
-                    size_t test_ind = std::distance(test.begin(), test_match_it);
-                            
-                    if (matches_overlap(true_match, test_match, arguments.min_overlap))
-                    {
-                        if (test_found_matches[test_ind] == 0)
-                            true_positive_count++;
+                auto is_next_ref = [&](auto const & match) { return match.ref_ind != seq.ind ;};
+                auto truth_ref_end = std::find_if(truth_ref_begin, truth.end(), is_next_ref);
+                auto test_ref_end = std::find_if(test_ref_begin, test.end(), is_next_ref);
+                seqan3::debug_stream << truth_ref_end - truth_ref_begin << '\t' << test_ref_end - test_ref_begin << '\n';
 
-                        test_found_matches[test_ind] = 1;                            
-                        only_in_truth_set = false;
-                        //break;
-                    }    
-                }
-                if (only_in_truth_set)
-                    false_negatives.push_back(true_match);    
+                truth_ref_begin = truth_ref_end;
+                test_ref_begin = test_ref_end;
             }
-
-            truth_ref_begin = truth_ref_end;
-            test_ref_begin = test_ref_end;
         }
 
+        auto const results = timed_evaluate_accuracy(truth, test, test_file, arguments, arguments.threads,
+                                                     statistics);
+        print_accuracy_report(write_false_matches(arguments, meta, 0, truth, dictionary, test, dictionary,
+                                                  test_loaded_count, results, statistics));
 
-        for (size_t i{0}; i < test.size(); i++)
-        {
-            if (test_found_matches[i] == 0)
-                false_positives.push_back(test[i]);
-        }
-
-        seqan3::debug_stream << "Accuracy report\n"; 
-        seqan3::debug_stream << "True positives\t" << true_positive_count << '\n';
-        seqan3::debug_stream << "False positives\t" << false_positives.size() << '\n';
-        seqan3::debug_stream << "False negatives\t" << false_negatives.size() << '\n';
+    }, valik::is_stellar_input(arguments.truth_file), valik::is_stellar_input(test_file));
 
-        std::filesystem::path false_negative_out = arguments.out;
-        false_negative_out.replace_extension("fn" + arguments.truth_file.extension().string());
-        std::filesystem::path false_positive_out = arguments.out;
-        false_positive_out.replace_extension("fp" + arguments.test_file.extension().string());
-
-        valik::write_alignment_output(false_negative_out, false_negatives);            
-        valik::write_alignment_output(false_positive_out, false_positives);
+}
 
-    }, (arguments.truth_file.extension() == ".gff"), (arguments.test_file.extension() == ".gff"));
+// ./evaluate --truth ../test/data/truth.gff --test ../test/data/test.gff --ref-meta ../test/data/meta.bin
+void search_accuracy(accuracy_arguments const & arguments)
+{
+    if (arguments.stats_json.empty())
+    {
+        evaluate(arguments, nullptr);
+        return;
+    }
 
+    valik::start_counting_allocations();
+    valik::run_statistics statistics{};
+    evaluate(arguments, &statistics);
+    statistics.write_json(arguments.stats_json);
 }
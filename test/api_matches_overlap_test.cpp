@@ -4,6 +4,12 @@
 
 #include <gtest/gtest.h>
 
+#include <map>
+#include <random>
+#include <set>
+
+#include <unistd.h>
+
 #include <accuracy/search_accuracy.hpp>
 #include <utilities/consolidate/stellar_match.hpp>
 
@@ -13,122 +19,222 @@
 struct evaluate_alignments : public app_test
 {};
 
+// Metadata lookup
+
+TEST_F(evaluate_alignments, metadata_ind_from_id)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+
+    for (auto const & seq : meta.sequences)
+        EXPECT_EQ(meta.ind_from_id(seq.id), seq.ind);
+
+    std::vector<std::string> ids{"NC_000081.7", "Concatenated", "NC_000067.7"};
+    EXPECT_EQ(meta.inds_from_ids(ids), (std::vector<size_t>{15, 23, 0}));
+    EXPECT_THROW(meta.ind_from_id("chrUn"), seqan3::validation_error);
+}
+
+// Line splitting
+
+TEST_F(evaluate_alignments, split_line)
+{
+    std::array<std::string_view, 3> fields;
+    EXPECT_EQ(valik::split_line("a;bc;;d", ';', fields), 4u);
+    EXPECT_EQ(fields, (std::array<std::string_view, 3>{"a", "bc", ""}));
+    EXPECT_EQ(valik::split_line("a;bc;", ';', fields), 2u);
+    EXPECT_EQ(valik::split_line("", ';', fields), 0u);
+}
+
+TEST_F(evaluate_alignments, gff_from_string_views)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    std::string const line{"NC_000081.7\tStellar\teps-matches\t900\t1050\t97.7011\t-\t.\t2R;seq2Range=0,155;eValue=1e-10;cigar=150M;mutations=87T"};
+    std::array<std::string_view, 9> fields;
+    ASSERT_EQ(valik::split_line(line, '\t', fields), 9u);
+
+    valik::match_dictionary dictionary{};
+    valik::stellar_match match(fields, meta, dictionary);
+    EXPECT_EQ(match.ref_ind, 15u);
+    EXPECT_EQ(match.dbegin, 900u);
+    EXPECT_EQ(match.dend, 1050u);
+    EXPECT_FALSE(match.is_forward_match);
+    EXPECT_EQ(dictionary.query_name(match.qid), "2R");
+    EXPECT_EQ(match.qbegin, 0u);
+    EXPECT_EQ(match.qend, 155u);
+    EXPECT_EQ(match.evalue, 1e-10);
+    EXPECT_EQ(dictionary.text(match.alignment_attributes), "eValue=1e-10;cigar=150M;mutations=87T");
+    EXPECT_EQ(match.to_string(meta, dictionary), line + "\n");
+}
+
+TEST_F(evaluate_alignments, parse_numbers)
+{
+    EXPECT_EQ(valik::parse_number<uint64_t>("4294967396"), 4294967396ULL);
+    EXPECT_EQ(valik::parse_number<uint64_t>("150\r"), 150u);
+    EXPECT_FLOAT_EQ(valik::parse_number<float>("97.7011"), 97.7011f);
+    EXPECT_EQ(valik::parse_number<double>("1e-400"), 0.0);
+    EXPECT_THROW(valik::parse_number<uint64_t>("-150"), std::runtime_error);
+    EXPECT_THROW(valik::parse_number<uint64_t>("150M"), std::runtime_error);
+    EXPECT_THROW(valik::parse_number<uint64_t>(""), std::runtime_error);
+}
+
+TEST_F(evaluate_alignments, number_round_trip)
+{
+    valik::match_dictionary dictionary{};
+    std::array<char, valik::match_dictionary::max_number_length> buffer;
+
+    for (std::string_view const field : {"97.7011", "97.50", "100", "0.0", "2e-50", "5.33026e-57", "1e-180", "1.5E-10", "1e-5"})
+    {
+        double const value = valik::parse_number<double>(field);
+        EXPECT_EQ(dictionary.number_text(value, dictionary.format_of(field, value), buffer), field);
+
+        float const single = valik::parse_number<float>(field);
+        EXPECT_EQ(dictionary.number_text(single, dictionary.format_of(field, single), buffer), field);
+    }
+
+    EXPECT_EQ(dictionary.format_of("97.7011", 97.7011).notation, valik::number_format::style::fixed);
+    EXPECT_EQ(dictionary.format_of("2e-50", 2e-50).notation, valik::number_format::style::scientific);
+    EXPECT_EQ(dictionary.format_of("1.5E-10", 1.5e-10).notation, valik::number_format::style::verbatim);
+}
+
+TEST_F(evaluate_alignments, blast_large_coordinates)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
+
+    std::vector<std::string> match_vec{"NC_000081.7", "3000000000", "3000000150", "97.7011", "plus", "5.33026e-57", "2R", "2999999990", "3000000140"};
+    blast_match match(match_vec, meta, dictionary);
+    EXPECT_EQ(match.dbegin, 3000000000ULL);
+    EXPECT_EQ(match.dend, 3000000150ULL);
+    EXPECT_EQ(match.qbegin, 2999999990ULL);
+    EXPECT_EQ(match.qend, 3000000140ULL);
+    EXPECT_DOUBLE_EQ(match.evalue, 5.33026e-57);
+    EXPECT_EQ(match.to_string(meta, dictionary), "NC_000081.7\t3000000000\t3000000150\t97.7011\tplus\t5.33026e-57\t2R\t2999999990\t3000000140\n");
+}
+
 // GFF vs GFF comparison
 
 TEST_F(evaluate_alignments, gff_db_pos_not_equal)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"94741310",	"94741481",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7",   "Stellar", "eps-matches",	"84741310",	"84741481",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match test_match(test_vec, meta);
+    valik::stellar_match test_match(test_vec, meta, dictionary);
     EXPECT_FALSE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, gff_db_pos_overlap_too_short)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"150",	"300",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7",   "Stellar", "eps-matches",	"300",	"450",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match test_match(test_vec, meta);
+    valik::stellar_match test_match(test_vec, meta, dictionary);
     EXPECT_FALSE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, gff_q_pos_overlap_too_short)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"150",	"300",	"97.7011",	"+",	".",	"2R;seq2Range=150,305;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7",   "Stellar", "eps-matches",	"300",	"450",	"97.7011",	"+",	".",	"2R;seq2Range=300,450;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match test_match(test_vec, meta);
+    valik::stellar_match test_match(test_vec, meta, dictionary);
     EXPECT_FALSE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, gff_db_overlaps_left)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"900",	"1050",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7",   "Stellar", "eps-matches",	"1040",	"1190",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match test_match(test_vec, meta);
+    valik::stellar_match test_match(test_vec, meta, dictionary);
     EXPECT_TRUE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, gff_db_overlaps_right)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"1180",	"1300",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7",   "Stellar", "eps-matches",	"1040",	"1190",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match test_match(test_vec, meta);
+    valik::stellar_match test_match(test_vec, meta, dictionary);
     EXPECT_TRUE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, gff_truth_db_overlaps)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"1040",	"1350",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7",   "Stellar", "eps-matches",	"1180",	"1300",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match test_match(test_vec, meta);
+    valik::stellar_match test_match(test_vec, meta, dictionary);
     EXPECT_TRUE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, gff_test_db_overlaps)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"1180",	"1300",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7",   "Stellar", "eps-matches",	"1040",	"1350",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match test_match(test_vec, meta);
+    valik::stellar_match test_match(test_vec, meta, dictionary);
     EXPECT_TRUE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, gff_db_overlaps_q_overlap_too_short)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"900",	"1050",	"97.7011",	"+",	".",	"2R;seq2Range=0,155;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7",   "Stellar", "eps-matches",	"1040",	"1190",	"97.7011",	"+",	".",	"2R;seq2Range=150,300;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match test_match(test_vec, meta);
+    valik::stellar_match test_match(test_vec, meta, dictionary);
     EXPECT_FALSE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, gff_opposite_strand)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"900",	"1050",	"97.7011",	"+",	".",	"2R;seq2Range=0,155;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7",   "Stellar", "eps-matches",	"900",	"1050",	"97.7011",	"-",	".",	"2R;seq2Range=0,155;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match test_match(test_vec, meta);
+    valik::stellar_match test_match(test_vec, meta, dictionary);
     EXPECT_FALSE(matches_overlap(truth_match, test_match, overlap));
 }
 
@@ -137,91 +243,98 @@ TEST_F(evaluate_alignments, gff_opposite_strand)
 TEST_F(evaluate_alignments, blast_db_pos_not_equal)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"94741310",	"94741481",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7", "84741310", "84741481", "97.7011", "plus", "0.01", "2R", "1825699", "1825871"};
-    blast_match test_match(test_vec, meta);
+    blast_match test_match(test_vec, meta, dictionary);
     EXPECT_FALSE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, blast_db_pos_overlap_too_short)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"150",	"300",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7",   "300",	"450",	"97.7011",	"plus",	"0.01",	"2R", "1825699", "1825871"};
-    blast_match test_match(test_vec, meta);
+    blast_match test_match(test_vec, meta, dictionary);
     EXPECT_FALSE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, blast_q_pos_overlap_too_short)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"150",	"300",	"97.7011",	"+",	".",	"2R;seq2Range=150,305;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7", "300",	"450", "97.7011", "plus", "0.01", "2R", "300", "450"};
-    blast_match test_match(test_vec, meta);
+    blast_match test_match(test_vec, meta, dictionary);
     EXPECT_FALSE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, blast_db_overlaps_left)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"900",	"1050",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7", "1040",	"1190",	"97.7011",	"plus",	"0.01",	"2R", "1825699", "1825871"};
-    blast_match test_match(test_vec, meta);
+    blast_match test_match(test_vec, meta, dictionary);
     EXPECT_TRUE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, blast_db_overlaps_right)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"1180",	"1300",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7", "1040", "1190", "97.7011",	"plus",	"0.01",	"2R", "1825699","1825871"};
-    blast_match test_match(test_vec, meta);
+    blast_match test_match(test_vec, meta, dictionary);
     EXPECT_TRUE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, blast_truth_db_overlaps)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"1040",	"1350",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7", "1180", "1300", "97.7011",	"plus",	"0.01",	"2R", "1825699","1825871"};
-    blast_match test_match(test_vec, meta);
+    blast_match test_match(test_vec, meta, dictionary);
     EXPECT_TRUE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, blast_test_db_overlaps)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"1180",	"1300",	"97.7011",	"+",	".",	"2R;seq2Range=1825699,1825871;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7",	"1040",	"1350",	"97.7011",	"plus",	"0.01",	"2R", "1825699","1825871"};
-    blast_match test_match(test_vec, meta);
+    blast_match test_match(test_vec, meta, dictionary);
     EXPECT_TRUE(matches_overlap(truth_match, test_match, overlap));
 }
 
@@ -229,25 +342,589 @@ TEST_F(evaluate_alignments, blast_test_db_overlaps)
 TEST_F(evaluate_alignments, blast_db_overlaps_q_overlap_too_short)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"900",	"1050",	"97.7011",	"+",	".",	"2R;seq2Range=0,155;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7",   "1040",	"1190",	"97.7011",	"plus",	"0.01",	"2R", "150","300"};
-    blast_match test_match(test_vec, meta);
+    blast_match test_match(test_vec, meta, dictionary);
     EXPECT_FALSE(matches_overlap(truth_match, test_match, overlap));
 }
 
 TEST_F(evaluate_alignments, blast_opposite_strand)
 {
     valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
     size_t const overlap{10};
 
     std::vector<std::string> truth_vec{"NC_000081.7",   "Stellar", "eps-matches",	"900",	"1050",	"97.7011",	"+",	".",	"2R;seq2Range=0,155;cigar=85M1D8M1I76M1I2M;mutations=87T,94T,171C"};
-    valik::stellar_match truth_match(truth_vec, meta);
+    valik::stellar_match truth_match(truth_vec, meta, dictionary);
 
     std::vector<std::string> test_vec{"NC_000081.7", "900", "1050",	"97.7011", "minus", "0.01",	"2R", "0", "155"};
-    blast_match test_match(test_vec, meta);
+    blast_match test_match(test_vec, meta, dictionary);
     EXPECT_FALSE(matches_overlap(truth_match, test_match, overlap));
 }
+
+// Interval index
+
+TEST_F(evaluate_alignments, interval_index_finds_pairs_of_gff_matches)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
+    auto truth = get_sorted_alignments<valik::stellar_match>(data("truth.gff"), meta, dictionary);
+    auto test = get_sorted_alignments<valik::stellar_match>(data("test.gff"), meta, dictionary);
+    truth_interval_index const index(truth);
+
+    for (size_t const overlap : {10, 50, 100})
+    {
+        std::set<std::pair<size_t, size_t>> expected{};
+        for (size_t i{0}; i < truth.size(); i++)
+            for (size_t j{0}; j < test.size(); j++)
+                if (truth[i].ref_ind == test[j].ref_ind && matches_overlap(truth[i], test[j], overlap))
+                    expected.emplace(i, j);
+
+        std::set<std::pair<size_t, size_t>> found{};
+        for (size_t j{0}; j < test.size(); j++)
+            index.for_each_overlap(test[j], overlap, [&](size_t const i, int64_t) { found.emplace(i, j); });
+
+        EXPECT_FALSE(expected.empty());
+        EXPECT_EQ(found, expected);
+    }
+}
+
+TEST_F(evaluate_alignments, interval_index_finds_all_overlapping_pairs)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
+    auto truth = get_sorted_alignments<blast_match>(data("truth.txt"), meta, dictionary);
+    auto test = get_sorted_alignments<valik::stellar_match>(data("test.gff"), meta, dictionary);
+
+    // the index does not depend on the order of the truth matches
+    std::vector<blast_match> shuffled_truth(truth.rbegin(), truth.rend());
+    truth_interval_index const index(shuffled_truth);
+
+    for (size_t const overlap : {0, 10, 50, 100})
+    {
+        std::set<std::pair<size_t, size_t>> expected{};
+        for (size_t i{0}; i < shuffled_truth.size(); i++)
+            for (size_t j{0}; j < test.size(); j++)
+                if (shuffled_truth[i].ref_ind == test[j].ref_ind &&
+                    matches_overlap(shuffled_truth[i], test[j], overlap))
+                    expected.emplace(i, j);
+
+        std::set<std::pair<size_t, size_t>> found{};
+        for (size_t j{0}; j < test.size(); j++)
+        {
+            index.for_each_overlap(test[j], overlap, [&](size_t const i, int64_t const length)
+            {
+                EXPECT_EQ(length, matches_overlap_length(shuffled_truth[i], test[j]));
+                EXPECT_TRUE(found.emplace(i, j).second);
+            });
+        }
+
+        EXPECT_FALSE(expected.empty());
+        EXPECT_EQ(found, expected);
+    }
+}
+
+TEST_F(evaluate_alignments, overlap_kernel)
+{
+    struct position_match
+    {
+        uint64_t dbegin, dend, qbegin, qend;
+        uint32_t qid{0};
+        bool is_forward_match{true};
+    };
+
+    std::mt19937_64 generator{42};
+    auto random_match = [&]()
+    {
+        uint64_t const dbegin = generator() % 1000;
+        uint64_t const qbegin = generator() % 1000;
+        return position_match{dbegin, dbegin + generator() % 200, qbegin, qbegin + generator() % 200};
+    };
+
+    valik::match_columns columns{};
+    std::vector<position_match> matches{};
+    for (size_t i{0}; i < 1000; i++)
+    {
+        matches.push_back(random_match());
+        columns.push_back(matches.back());
+    }
+
+    for (size_t round{0}; round < 100; round++)
+    {
+        position_match const probe_match = random_match();
+        valik::overlap_probe const probe{probe_match.dbegin, probe_match.dend, probe_match.qbegin, probe_match.qend};
+        int64_t const overlap = generator() % 100;
+        size_t const first = generator() % (matches.size() - valik::overlap_block_size);
+        size_t const count = 1 + generator() % valik::overlap_block_size;
+
+        std::array<int64_t, valik::overlap_block_size> lengths{};
+        std::array<int64_t, valik::overlap_block_size> scalar_lengths{};
+        uint32_t const hits = valik::overlap_block(columns, first, count, probe, overlap, lengths.data());
+        EXPECT_EQ(hits, valik::detail::scalar_overlap_block(columns, first, count, probe, overlap,
+                                                             scalar_lengths.data()));
+        EXPECT_EQ(lengths, scalar_lengths);
+        for (size_t k{0}; k < count; k++)
+        {
+            EXPECT_EQ(lengths[k], matches_overlap_length(matches[first + k], probe_match));
+            EXPECT_EQ((bool) (hits >> k & 1), matches_overlap(matches[first + k], probe_match, overlap));
+        }
+        EXPECT_EQ(hits >> count, 0u);
+    }
+}
+
+TEST_F(evaluate_alignments, consolidate_keeps_longest_matches_per_query)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
+    auto matches = get_sorted_alignments<valik::stellar_match>(data("test.gff"), meta, dictionary);
+
+    accuracy_arguments arguments{};
+    arguments.numMatches = 3;
+    arguments.disableThresh = 20;
+
+    // <query_ind, match lengths in decreasing order>
+    std::map<uint32_t, std::vector<uint64_t>> expected{};
+    for (auto const & match : matches)
+        expected[match.qid].push_back(match.dend - match.dbegin);
+    std::erase_if(expected, [&](auto const & query) { return query.second.size() >= arguments.disableThresh; });
+    for (auto & [qid, lengths] : expected)
+    {
+        std::ranges::sort(lengths, std::greater<uint64_t>());
+        lengths.resize(std::min(lengths.size(), arguments.numMatches));
+    }
+
+    valik::custom::consolidate_matches(matches, dictionary, arguments);
+    EXPECT_TRUE(std::ranges::is_sorted(matches, std::less<valik::stellar_match>()));
+
+    std::map<uint32_t, std::vector<uint64_t>> consolidated{};
+    for (auto const & match : matches)
+        consolidated[match.qid].push_back(match.dend - match.dbegin);
+    for (auto & [qid, lengths] : consolidated)
+        std::ranges::sort(lengths, std::greater<uint64_t>());
+
+    EXPECT_EQ(consolidated, expected);
+}
+
+TEST_F(evaluate_alignments, streaming_finds_same_matches)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
+    auto truth = get_sorted_alignments<valik::stellar_match>(data("truth.gff"), meta, dictionary);
+    auto test = get_sorted_alignments<valik::stellar_match>(data("test.gff"), meta, dictionary);
+    valik::write_alignment_output("sorted_truth.gff", truth, meta, dictionary);
+    valik::write_alignment_output("sorted_test.gff", test, meta, dictionary);
+
+    size_t const overlap{10};
+    accuracy_result const expected = evaluate_accuracy(truth, test, overlap, 1);
+    std::vector<uint8_t> truth_found(truth.size(), 1);
+    std::vector<uint8_t> test_found(test.size(), 1);
+    for (size_t const i : expected.false_negatives)
+        truth_found[i] = 0;
+    for (size_t const j : expected.false_positives)
+        test_found[j] = 0;
+
+    valik::match_dictionary stream_dictionary{};
+    valik::alignment_reader<valik::stellar_match> truth_reader("sorted_truth.gff", meta, stream_dictionary);
+    valik::alignment_reader<valik::stellar_match> test_reader("sorted_test.gff", meta, stream_dictionary);
+    size_t truth_ind{0};
+    size_t test_ind{0};
+    stream_overlapping_matches(truth_reader, test_reader, overlap, stream_dictionary,
+                               [&](valik::stellar_match const & match, bool const found)
+    {
+        ASSERT_LT(truth_ind, truth.size());
+        EXPECT_EQ(match.to_string(meta, stream_dictionary), truth[truth_ind].to_string(meta, dictionary));
+        EXPECT_EQ(found, truth_found[truth_ind] == 1);
+        truth_ind++;
+    },
+                               [&](valik::stellar_match const & match, bool const found)
+    {
+        ASSERT_LT(test_ind, test.size());
+        EXPECT_EQ(match.to_string(meta, stream_dictionary), test[test_ind].to_string(meta, dictionary));
+        EXPECT_EQ(found, test_found[test_ind] == 1);
+        test_ind++;
+    });
+
+    EXPECT_EQ(truth_ind, truth.size());
+    EXPECT_EQ(test_ind, test.size());
+
+    valik::alignment_reader<valik::stellar_match> unsorted_reader(data("truth.gff"), meta, stream_dictionary);
+    valik::alignment_reader<valik::stellar_match> sorted_reader("sorted_test.gff", meta, stream_dictionary);
+    EXPECT_THROW(stream_overlapping_matches(unsorted_reader, sorted_reader, overlap, stream_dictionary,
+                                            [](auto const &, bool) {}, [](auto const &, bool) {}),
+                 std::runtime_error);
+}
+
+TEST_F(evaluate_alignments, external_sort)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
+    auto matches = get_sorted_alignments<valik::stellar_match>(data("test.gff"), meta, dictionary);
+    std::multiset<std::string> expected{};
+    for (auto const & match : matches)
+        expected.insert(match.to_string(meta, dictionary));
+
+    for (size_t const memory_limit : {size_t{1} << 12, size_t{1} << 30})
+    {
+        valik::match_dictionary sort_dictionary{};
+        valik::sorted_alignment_reader<valik::stellar_match> reader(data("test.gff"), meta, sort_dictionary, memory_limit);
+        EXPECT_EQ(reader.run_count() > 1, memory_limit < (size_t{1} << 30));
+
+        std::vector<valik::stellar_match> sorted{};
+        std::multiset<std::string> found{};
+        while (auto match = reader.next())
+        {
+            sorted.push_back(*match);
+            found.insert(match->to_string(meta, sort_dictionary));
+        }
+
+        EXPECT_TRUE(std::ranges::is_sorted(sorted, std::less<valik::stellar_match>()));
+        EXPECT_EQ(found, expected);
+        EXPECT_EQ(reader.match_count(), matches.size());
+    }
+
+    // spilled runs are removed if a later record can not be read
+    auto spill_files = []()
+    {
+        std::string const prefix = "valik_evaluate_" + std::to_string(getpid()) + "_";
+        size_t count{0};
+        for (auto const & entry : std::filesystem::directory_iterator(std::filesystem::temp_directory_path()))
+            count += entry.path().filename().string().starts_with(prefix);
+        return count;
+    };
+    size_t const spill_files_before = spill_files();
+    std::string const text = string_from_file(data("test.gff"));
+    std::ofstream{"unknown_reference.gff"} << text << "unknown\t" << text.substr(text.find('\t') + 1);
+    valik::match_dictionary sort_dictionary{};
+    EXPECT_THROW((valik::sorted_alignment_reader<valik::stellar_match>("unknown_reference.gff", meta, sort_dictionary,
+                                                                         size_t{1} << 12)),
+                 std::exception);
+    EXPECT_EQ(spill_files(), spill_files_before);
+}
+
+TEST_F(evaluate_alignments, write_gathered_matches)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
+    auto matches = valik::read_alignment_output<blast_match>(data("truth.txt"), meta, dictionary);
+
+    std::vector<size_t> indices{};
+    std::string expected{};
+    for (size_t i{0}; i < matches.size(); i += 3)
+    {
+        indices.push_back(i);
+        expected += matches[i].to_string(meta, dictionary);
+    }
+
+    std::ostringstream buffered{};
+    {
+        valik::alignment_writer out(buffered, 300);
+        for (size_t const i : indices)
+            matches[i].write(out, meta, dictionary);
+    }
+    EXPECT_EQ(buffered.str(), expected);
+
+    valik::write_alignment_output("gathered.txt",
+                                  indices | std::views::transform([&](size_t const i) -> blast_match const &
+                                  {
+                                      return matches[i];
+                                  }),
+                                  meta,
+                                  dictionary);
+    EXPECT_EQ(string_from_file("gathered.txt"), expected);
+}
+
+TEST_F(evaluate_alignments, evaluate_accuracy_indices)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
+    auto truth = get_sorted_alignments<blast_match>(data("truth.txt"), meta, dictionary);
+    auto test = get_sorted_alignments<valik::stellar_match>(data("test.gff"), meta, dictionary);
+
+    size_t const overlap{50};
+    accuracy_result expected{};
+    std::vector<uint8_t> test_found(test.size(), 0);
+    for (size_t i{0}; i < truth.size(); i++)
+    {
+        bool found{false};
+        for (size_t j{0}; j < test.size(); j++)
+        {
+            if (truth[i].ref_ind == test[j].ref_ind && matches_overlap(truth[i], test[j], overlap))
+            {
+                found = true;
+                test_found[j] = 1;
+            }
+        }
+        if (!found)
+            expected.false_negatives.push_back(i);
+    }
+    for (size_t j{0}; j < test.size(); j++)
+    {
+        if (test_found[j])
+            expected.true_positive_count++;
+        else
+            expected.false_positives.push_back(j);
+    }
+
+    for (size_t const threads : {1, 4})
+    {
+        accuracy_result const result = evaluate_accuracy(truth, test, overlap, threads);
+        EXPECT_EQ(result.true_positive_count, expected.true_positive_count);
+        EXPECT_EQ(result.false_negatives, expected.false_negatives);
+        EXPECT_EQ(result.false_positives, expected.false_positives);
+    }
+
+    auto false_positives = gather_matches(test, expected.false_positives);
+    ASSERT_EQ(std::ranges::size(false_positives), expected.false_positives.size());
+    ASSERT_FALSE(expected.false_positives.empty());
+    EXPECT_EQ(&false_positives[0], &test[expected.false_positives[0]]);
+}
+
+TEST_F(evaluate_alignments, evaluate_several_overlaps)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
+    auto truth = get_sorted_alignments<valik::stellar_match>(data("truth.gff"), meta, dictionary);
+    auto test = get_sorted_alignments<valik::stellar_match>(data("test.gff"), meta, dictionary);
+
+    EXPECT_EQ(matches_overlap_length(truth[0], truth[0]), (int64_t) (truth[0].dend - truth[0].dbegin));
+
+    std::vector<size_t> const overlaps{100, 0, 10, 50, 150};
+    for (size_t const threads : {1, 3})
+    {
+        auto const results = evaluate_accuracy(truth, test, overlaps, threads);
+        ASSERT_EQ(results.size(), overlaps.size());
+        for (size_t t{0}; t < overlaps.size(); t++)
+        {
+            accuracy_result const expected = evaluate_accuracy(truth, test, overlaps[t], 1);
+            EXPECT_EQ(results[t].true_positive_count, expected.true_positive_count);
+            EXPECT_EQ(results[t].false_negatives, expected.false_negatives);
+            EXPECT_EQ(results[t].false_positives, expected.false_positives);
+        }
+    }
+}
+
+TEST_F(evaluate_alignments, parse_in_parallel)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    std::string const text = string_from_file(data("test.gff"));
+
+    valik::match_dictionary expected_dictionary{};
+    std::vector<valik::stellar_match> expected{};
+    bool expected_is_sorted{true};
+    valik::parse_alignments(text, expected, meta, expected_dictionary, expected_is_sorted);
+
+    valik::match_dictionary dictionary{};
+    dictionary.query_id("already seen");
+    auto [matches, is_sorted] = valik::parse_alignments_parallel<valik::stellar_match>(text, meta, dictionary, 4, 256);
+    EXPECT_EQ(is_sorted, expected_is_sorted);
+    ASSERT_EQ(matches.size(), expected.size());
+    for (size_t i{0}; i < matches.size(); i++)
+    {
+        EXPECT_EQ(matches[i].to_string(meta, dictionary), expected[i].to_string(meta, expected_dictionary));
+        EXPECT_EQ(matches[i].qid, expected[i].qid + 1);
+    }
+
+    // lines after one that is not an alignment are ignored
+    size_t const middle = text.find('\n', text.size() / 2) + 1;
+    std::string const truncated = text.substr(0, middle) + "output.gff\n" + text.substr(middle);
+    valik::match_dictionary truncated_dictionary{};
+    auto truncated_matches = valik::parse_alignments_parallel<valik::stellar_match>(truncated, meta, truncated_dictionary, 4, 256).matches;
+    EXPECT_LT(truncated_matches.size(), expected.size());
+    EXPECT_GT(truncated_matches.size(), 0u);
+
+    // so are malformed lines after it, but not before it
+    std::string const malformed{"unknown\tStellar\teps-matches\t1\t100\t99.0\t+\t.\t2R;seq2Range=1,100\n"};
+    valik::match_dictionary malformed_dictionary{};
+    auto const ignored = valik::parse_alignments_parallel<valik::stellar_match>(truncated + malformed, meta,
+                                                                                malformed_dictionary, 4, 256).matches;
+    EXPECT_EQ(ignored.size(), truncated_matches.size());
+    EXPECT_ANY_THROW((valik::parse_alignments_parallel<valik::stellar_match>(malformed + truncated, meta,
+                                                                             malformed_dictionary, 4, 256)));
+}
+
+TEST_F(evaluate_alignments, blank_and_short_lines)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    std::string const text = string_from_file(data("test.gff"));
+    size_t const middle = text.find('\n', text.size() / 2) + 1;
+
+    // passes the text as a regular file, as a pipe that can not be mapped and to the reader of one alignment at a time
+    auto for_each_reader = [&](std::string const & input, auto && read)
+    {
+        std::ofstream{"lines.gff"} << input;
+        read([&](valik::match_dictionary & dictionary)
+        {
+            return valik::read_alignment_output<valik::stellar_match>("lines.gff", meta, dictionary);
+        });
+        read([&](valik::match_dictionary & dictionary)
+        {
+            return valik::read_alignment_output<valik::stellar_match>("lines.gff", meta, dictionary,
+                                                                      std::ios_base::in, 4);
+        });
+
+        int pipe_ends[2];
+        ASSERT_EQ(pipe(pipe_ends), 0);
+        ASSERT_EQ(write(pipe_ends[1], input.data(), input.size()), (ssize_t) input.size());
+        close(pipe_ends[1]);
+        read([&](valik::match_dictionary & dictionary)
+        {
+            return valik::read_alignment_output<valik::stellar_match>("/proc/self/fd/" + std::to_string(pipe_ends[0]),
+                                                                      meta, dictionary);
+        });
+        close(pipe_ends[0]);
+
+        read([&](valik::match_dictionary & dictionary)
+        {
+            valik::alignment_reader<valik::stellar_match> reader("lines.gff", meta, dictionary);
+            std::vector<valik::stellar_match> matches{};
+            while (auto match = reader.next())
+                matches.push_back(*match);
+            return matches;
+        });
+    };
+
+    // empty lines are skipped
+    for_each_reader(text.substr(0, middle) + "\n" + text.substr(middle) + "\n", [](auto && read_matches)
+    {
+        valik::match_dictionary dictionary{};
+        EXPECT_EQ(read_matches(dictionary).size(), 40u);
+    });
+
+    // short lines are an error instead of reusing the fields of the line before them
+    std::string const short_line{"NC_000069.7\tStellar\teps-matches\t1\t100\n"};
+    for_each_reader(text.substr(0, middle) + short_line + text.substr(middle), [](auto && read_matches)
+    {
+        valik::match_dictionary dictionary{};
+        EXPECT_THROW(read_matches(dictionary), std::runtime_error);
+    });
+}
+
+TEST_F(evaluate_alignments, radix_sort)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
+    std::vector<valik::stellar_match> parsed{};
+    bool is_sorted{true};
+    valik::parse_alignments(string_from_file(data("test.gff")), parsed, meta, dictionary, is_sorted);
+    ASSERT_FALSE(parsed.empty());
+
+    // enough copies for several blocks; qbegin tells apart matches with equal keys
+    std::vector<valik::stellar_match> matches{};
+    for (size_t copy{0}; matches.size() < (1u << 18); copy++)
+    {
+        for (auto match : parsed)
+        {
+            match.qbegin = matches.size();
+            if (copy % 3 == 1)
+                match.dend += (1ULL << 40);
+            matches.push_back(match);
+        }
+    }
+    std::reverse(matches.begin(), matches.end());
+
+    auto expect_stable_order = [](std::vector<valik::stellar_match> matches, size_t const thread_count)
+    {
+        auto expected = matches;
+        std::stable_sort(expected.begin(), expected.end());
+        valik::sort_matches(matches, thread_count);
+        ASSERT_EQ(matches.size(), expected.size());
+        for (size_t i{0}; i < matches.size(); i++)
+            EXPECT_EQ(matches[i].qbegin, expected[i].qbegin);
+    };
+
+    expect_stable_order(matches, 1);
+    expect_stable_order(matches, 4);
+
+    // keys wider than 128 bits
+    matches.erase(matches.begin() + 1000, matches.end());
+    matches[0].ref_ind = std::numeric_limits<size_t>::max();
+    matches[1].dbegin = std::numeric_limits<uint64_t>::max() - 1;
+    matches[1].dend = std::numeric_limits<uint64_t>::max();
+    expect_stable_order(matches, 2);
+}
+
+TEST_F(evaluate_alignments, detect_sorted_input)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+    valik::match_dictionary dictionary{};
+    auto unsorted = valik::load_alignments<valik::stellar_match>(data("test.gff"), meta, dictionary);
+    EXPECT_EQ(unsorted.is_sorted, std::ranges::is_sorted(unsorted.matches, std::less<valik::stellar_match>()));
+
+    auto matches = get_sorted_alignments<valik::stellar_match>(data("test.gff"), meta, dictionary);
+    ASSERT_TRUE(std::ranges::is_sorted(matches, std::less<valik::stellar_match>()));
+    valik::write_alignment_output("sorted.gff", matches, meta, dictionary);
+    for (size_t thread_count : {1, 4})
+    {
+        valik::match_dictionary sorted_dictionary{};
+        auto sorted = valik::load_alignments<valik::stellar_match>("sorted.gff", meta, sorted_dictionary,
+                                                                   std::ios_base::in, thread_count);
+        EXPECT_TRUE(sorted.is_sorted);
+        EXPECT_EQ(sorted.matches.size(), matches.size());
+    }
+
+    // a match out of order at the border of two chunks
+    std::string const text = string_from_file("sorted.gff");
+    size_t const middle = text.find('\n', text.size() / 2) + 1;
+    std::string const swapped = text.substr(middle) + text.substr(0, middle);
+    valik::match_dictionary swapped_dictionary{};
+    EXPECT_TRUE(valik::parse_alignments_parallel<valik::stellar_match>(text, meta, swapped_dictionary, 2, 256).is_sorted);
+    EXPECT_FALSE(valik::parse_alignments_parallel<valik::stellar_match>(swapped, meta, swapped_dictionary, 2, 256).is_sorted);
+
+    // consolidation keeps the order
+    accuracy_arguments arguments{};
+    arguments.numMatches = 1;
+    valik::custom::consolidate_matches(matches, dictionary, arguments);
+    EXPECT_TRUE(std::ranges::is_sorted(matches, std::less<valik::stellar_match>()));
+}
+
+TEST_F(evaluate_alignments, match_cache)
+{
+    valik::custom::metadata meta(data("meta.bin"));
+
+    auto expect_round_trip = [&]<typename match_t>(std::filesystem::path const & input)
+    {
+        valik::match_dictionary dictionary{};
+        auto matches = get_sorted_alignments<match_t>(input, meta, dictionary);
+        valik::write_match_cache("matches.mcache", matches, meta, data("meta.bin"), dictionary);
+        EXPECT_EQ(valik::is_stellar_input("matches.mcache"), (std::is_same_v<match_t, valik::stellar_match>));
+
+        // the cache is loaded after other matches, so its ids and spans have to be translated
+        valik::match_dictionary cache_dictionary{};
+        cache_dictionary.query_id("already seen");
+        cache_dictionary.store("text");
+        auto cached = get_sorted_alignments<match_t>("matches.mcache", meta, cache_dictionary);
+        ASSERT_EQ(cached.size(), matches.size());
+        for (size_t i{0}; i < matches.size(); i++)
+            EXPECT_EQ(cached[i].to_string(meta, cache_dictionary), matches[i].to_string(meta, dictionary));
+    };
+    expect_round_trip.template operator()<valik::stellar_match>(data("test.gff"));
+    expect_round_trip.template operator()<blast_match>(data("truth.txt"));
+
+    valik::match_dictionary dictionary{};
+    EXPECT_THROW(valik::read_match_cache<valik::stellar_match>("matches.mcache", meta, dictionary), std::runtime_error);
+
+    // records that point outside of the metadata or the verbatim numbers of the cache are rejected
+    auto const matches = get_sorted_alignments<blast_match>(data("truth.txt"), meta, dictionary);
+    auto expect_corrupt = [&](auto const & corrupt)
+    {
+        auto corrupted = matches;
+        corrupt(corrupted.back());
+        valik::write_match_cache("corrupt.mcache", corrupted, meta, data("meta.bin"), dictionary);
+        valik::match_dictionary corrupt_dictionary{};
+        EXPECT_THROW(valik::read_match_cache<blast_match>("corrupt.mcache", meta, corrupt_dictionary),
+                     std::runtime_error);
+    };
+    expect_corrupt([&](blast_match & match) { match.ref_ind = meta.pos_by_ind.size(); });
+    expect_corrupt([](blast_match & match)
+    {
+        match.evalue_format = valik::number_format{valik::number_format::style::verbatim, 0, 1000};
+    });
+
+    meta.sequences.pop_back();
+    EXPECT_THROW(valik::read_match_cache<blast_match>("matches.mcache", meta, dictionary), std::runtime_error);
+}
@@ -2,11 +2,27 @@
 // SPDX-FileCopyrightText: 2016-2024 Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: CC0-1.0
 
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
 #include "app_test.hpp"
 
 // To prevent issues when running multiple CLI tests in parallel, give each CLI test unique names:
 struct alignment_evaluation : public app_test
-{};
+{
+    // Alignments with the same reference position may be written in any order.
+    static std::vector<std::string> sorted_lines(std::string const & text)
+    {
+        std::vector<std::string> lines{};
+        std::istringstream in{text};
+        for (std::string line; std::getline(in, line);)
+            lines.push_back(line);
+        std::sort(lines.begin(), lines.end());
+        return lines;
+    }
+};
 
 TEST_F(alignment_evaluation, missing_path)
 {
@@ -17,3 +33,135 @@ TEST_F(alignment_evaluation, missing_path)
     //EXPECT_EQ(result.err, "");
 }
 
+TEST_F(alignment_evaluation, multithreaded)
+{
+    app_test_result const result = execute_app("--truth", data("truth.gff"), "--test", data("test.gff"), "--ref-meta", data("meta.bin"),
+                                               "--overlap", "10", "--threads", "4", "--out", "test_gff_vs_gff_o10");
+
+    EXPECT_SUCCESS(result);
+    EXPECT_EQ(sorted_lines(string_from_file("test_gff_vs_gff_o10.fn.gff")),
+              sorted_lines(string_from_file(data("test_gff_vs_gff_o10.fn.gff"))));
+    EXPECT_EQ(sorted_lines(string_from_file("test_gff_vs_gff_o10.fp.gff")),
+              sorted_lines(string_from_file(data("test_gff_vs_gff_o10.fp.gff"))));
+}
+
+TEST_F(alignment_evaluation, match_cache)
+{
+    app_test_result const convert_truth = execute_app("convert", "--input", data("truth.gff"), "--ref-meta", data("meta.bin"),
+                                                      "--out", "truth.mcache");
+    EXPECT_SUCCESS(convert_truth);
+    app_test_result const convert_test = execute_app("convert", "--input", data("test.gff"), "--ref-meta", data("meta.bin"),
+                                                     "--out", "test.mcache");
+    EXPECT_SUCCESS(convert_test);
+
+    app_test_result const result = execute_app("--truth", "truth.mcache", "--test", "test.mcache", "--ref-meta", data("meta.bin"),
+                                               "--overlap", "10", "--out", "test_gff_vs_gff_o10");
+
+    EXPECT_SUCCESS(result);
+    EXPECT_EQ(sorted_lines(string_from_file("test_gff_vs_gff_o10.fn.gff")),
+              sorted_lines(string_from_file(data("test_gff_vs_gff_o10.fn.gff"))));
+    EXPECT_EQ(sorted_lines(string_from_file("test_gff_vs_gff_o10.fp.gff")),
+              sorted_lines(string_from_file(data("test_gff_vs_gff_o10.fp.gff"))));
+}
+
+TEST_F(alignment_evaluation, multiple_test_files)
+{
+    app_test_result const convert_test = execute_app("convert", "--input", data("test.gff"), "--ref-meta", data("meta.bin"),
+                                                     "--out", "cached.mcache");
+    EXPECT_SUCCESS(convert_test);
+
+    app_test_result const result = execute_app("--truth", data("truth.gff"), "--test", data("test.gff"), "--test", "cached.mcache",
+                                               "--ref-meta", data("meta.bin"), "--overlap", "10", "--threads", "2",
+                                               "--out", "sweep");
+
+    EXPECT_SUCCESS(result);
+    EXPECT_NE(result.err.find("Test\tOverlap\tTest matches\tTrue positives\tFalse positives\tFalse negatives\n"), std::string::npos);
+    for (std::string const prefix : {"sweep_test", "sweep_cached"})
+    {
+        EXPECT_EQ(sorted_lines(string_from_file(prefix + ".fn.gff")),
+                  sorted_lines(string_from_file(data("test_gff_vs_gff_o10.fn.gff"))));
+        EXPECT_EQ(sorted_lines(string_from_file(prefix + ".fp.gff")),
+                  sorted_lines(string_from_file(data("test_gff_vs_gff_o10.fp.gff"))));
+    }
+}
+
+TEST_F(alignment_evaluation, multiple_overlaps)
+{
+    app_test_result const result = execute_app("--truth", data("truth.gff"), "--test", data("test.gff"), "--ref-meta", data("meta.bin"),
+                                               "--overlap", "100", "--overlap", "10", "--out", "test_gff_vs_gff");
+
+    EXPECT_SUCCESS(result);
+    for (std::string const prefix : {"test_gff_vs_gff_o10", "test_gff_vs_gff_o100"})
+    {
+        EXPECT_EQ(sorted_lines(string_from_file(prefix + ".fn.gff")),
+                  sorted_lines(string_from_file(data(prefix + ".fn.gff"))));
+        EXPECT_EQ(sorted_lines(string_from_file(prefix + ".fp.gff")),
+                  sorted_lines(string_from_file(data(prefix + ".fp.gff"))));
+    }
+}
+
+TEST_F(alignment_evaluation, stats_json)
+{
+    app_test_result const result = execute_app("--truth", data("truth.gff"), "--test", data("test.gff"), "--ref-meta", data("meta.bin"),
+                                               "--numMatches", "3", "--out", "stats", "--stats-json", "stats.json");
+
+    EXPECT_SUCCESS(result);
+    std::string const stats = string_from_file("stats.json");
+    for (std::string const key : {"\"wall_seconds\"", "\"cpu_seconds\"", "\"peak_rss_bytes\"", "\"allocations\"",
+                                  "\"records_per_second\"", "\"bytes_per_second\""})
+        EXPECT_NE(stats.find(key), std::string::npos) << key;
+    for (std::string const phase : {"metadata load", "truth parse", "test parse", "truth consolidation",
+                                    "test consolidation", "overlap", "write"})
+        EXPECT_NE(stats.find("\"name\": \"" + phase + "\""), std::string::npos) << phase;
+}
+
+TEST_F(alignment_evaluation, streaming)
+{
+    app_test_result const result = execute_app("--truth", data("sorted_truth.gff"), "--test", data("sorted_test.gff"),
+                                               "--ref-meta", data("meta.bin"), "--overlap", "10", "--streaming",
+                                               "--out", "streaming_o10");
+
+    EXPECT_SUCCESS(result);
+    EXPECT_EQ(sorted_lines(string_from_file("streaming_o10.fn.gff")),
+              sorted_lines(string_from_file(data("test_gff_vs_gff_o10.fn.gff"))));
+    EXPECT_EQ(sorted_lines(string_from_file("streaming_o10.fp.gff")),
+              sorted_lines(string_from_file(data("test_gff_vs_gff_o10.fp.gff"))));
+}
+
+TEST_F(alignment_evaluation, streaming_unsorted)
+{
+    app_test_result const result = execute_app("--truth", data("truth.gff"), "--test", data("sorted_test.gff"),
+                                               "--ref-meta", data("meta.bin"), "--overlap", "10", "--streaming",
+                                               "--out", "streaming_unsorted");
+
+    EXPECT_FAILURE(result);
+    EXPECT_NE(result.err.find("[Error] "), std::string::npos);
+    EXPECT_NE(result.err.find("are not sorted"), std::string::npos);
+}
+
+TEST_F(alignment_evaluation, memory_limit)
+{
+    // the inputs are not sorted and are cut into several runs
+    app_test_result const result = execute_app("--truth", data("truth.gff"), "--test", data("test.gff"),
+                                               "--ref-meta", data("meta.bin"), "--overlap", "10", "--memory-limit", "4k",
+                                               "--out", "memory_limit_o10");
+
+    EXPECT_SUCCESS(result);
+    EXPECT_EQ(sorted_lines(string_from_file("memory_limit_o10.fn.gff")),
+              sorted_lines(string_from_file(data("test_gff_vs_gff_o10.fn.gff"))));
+    EXPECT_EQ(sorted_lines(string_from_file("memory_limit_o10.fp.gff")),
+              sorted_lines(string_from_file(data("test_gff_vs_gff_o10.fp.gff"))));
+}
+
+TEST_F(alignment_evaluation, num_matches_ties)
+{
+    // query 2R has seven equally long truth matches; the two that are furthest left in the reference are kept
+    app_test_result const result = execute_app("--truth", data("truth.gff"), "--test", data("test.gff"), "--ref-meta", data("meta.bin"),
+                                               "--overlap", "10", "--numMatches", "2", "--out", "test_gff_vs_gff_o10_n2");
+
+    EXPECT_SUCCESS(result);
+    EXPECT_EQ(sorted_lines(string_from_file("test_gff_vs_gff_o10_n2.fn.gff")),
+              sorted_lines(string_from_file(data("test_gff_vs_gff_o10_n2.fn.gff"))));
+    EXPECT_EQ(sorted_lines(string_from_file("test_gff_vs_gff_o10_n2.fp.gff")),
+              sorted_lines(string_from_file(data("test_gff_vs_gff_o10_n2.fp.gff"))));
+}
@@ -9,3 +9,6 @@
 
 ../../build/evaluate --test test.gff --truth truth.txt --ref-meta meta.bin --overlap 10 --out test_txt_vs_gff_o10
 ../../build/evaluate --test test.gff --truth truth.txt --ref-meta meta.bin --overlap 100 --out test_txt_vs_gff_o100
+
+# equally long truth matches of query 2R: --numMatches keeps those that are further left in the reference
+../../build/evaluate --test test.gff --truth truth.gff --ref-meta meta.bin --overlap 10 --numMatches 2 --out test_gff_vs_gff_o10_n2